@@ -0,0 +1,306 @@
+#ifndef __BASE_EVENT_TRACE_HH__
+#define __BASE_EVENT_TRACE_HH__
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Binary trace of the hot-path events of branch predictors and replacement
+ * policies, cheap enough to leave on for whole runs where a debug flag
+ * would format text on every call. Each SimObject that traces owns a
+ * writer, so appending takes no lock and no system call: records are
+ * stored straight into a memory-mapped window of the file.
+ *
+ * The file is a header followed by fixed-size 16-byte records.
+ * A trace either keeps every record, growing the file a window at a time,
+ * or is a ring that keeps the newest records only. The header counts the
+ * records appended as they are, so the file stays readable even if the
+ * simulator dies without closing it.
+ *
+ * Fields of a record per event:
+ *   GSelectLookup      key: branch pc   value: table index  extra: prediction
+ *   GSelectUncond      key: branch pc   value: history      extra: 1
+ *   GSelectUpdate      key: branch pc   value: table index  extra: taken | squashed << 1
+ *   GSelectSquash      key: 0           value: restored history
+ *   LRUIPVTouch        key: set         value: way          extra: old position << 8 | new position
+ *   LRUIPVReset        key: set         value: way          extra: insertion position << 8 | ipv
+ *   LRUIPVVictim       key: set         value: way          extra: whether the victim was valid
+ *   LRUIPVInvalidate   key: set         value: way
+ */
+namespace EventTrace
+{
+
+const char magic[8] = {'E', 'V', 'T', 'T', 'R', 'C', '0', '1'};
+
+/* Records start past the header, aligned for any page size up to 64KB so
+ * windows map page aligned */
+const size_t dataOffset = 65536;
+
+/* Records mapped at once when the trace grows, 16MB */
+const uint64_t windowRecords = 1 << 20;
+
+struct Header
+{
+    char magic[8];
+    uint64_t ring;              // Records kept in a ring, 0 if every record is kept
+    uint64_t appended;          // Records appended since the trace was opened
+    char source[64];            // Name of the SimObject that wrote the trace
+};
+
+enum Event : uint8_t
+{
+    None = 0,                   // Never written, unused space at the end of a window
+    GSelectLookup,
+    GSelectUncond,
+    GSelectUpdate,
+    GSelectSquash,
+    LRUIPVTouch,
+    LRUIPVReset,
+    LRUIPVVictim,
+    LRUIPVInvalidate,
+    NumEvents
+};
+
+const char *const eventNames[NumEvents] = {
+    "none", "gselect.lookup", "gselect.uncond", "gselect.update",
+    "gselect.squash", "lruipv.touch", "lruipv.reset", "lruipv.victim",
+    "lruipv.invalidate"
+};
+
+struct Record
+{
+    uint64_t key;
+    uint32_t value;
+    uint16_t extra;
+    uint8_t thread;
+    uint8_t event;
+};
+
+static_assert(sizeof(Record) == 16, "Event trace records must stay 16 bytes");
+static_assert(sizeof(Header) <= dataOffset, "Event trace header must fit before the records");
+
+/**
+ * Appends records to a trace file through a memory-mapped window.
+ */
+class Writer
+{
+    public:
+        Writer() : fd(-1), header(nullptr), window(nullptr), windowStart(0),
+                   windowLength(0), ring(0) {}
+        Writer(const Writer &) = delete;
+        Writer &operator=(const Writer &) = delete;
+        ~Writer() { close(); }
+
+        /**
+         * Creates the trace file and maps its header and first window.
+         * @param source Name of the traced object, kept in the header.
+         * @param ring Newest records to keep, 0 to keep them all.
+         * @return False if the file could not be created or mapped.
+         */
+        bool
+        open(const std::string &path, const std::string &source, uint64_t ring)
+        {
+            fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) {
+                return false;
+            }
+            this->ring = ring;
+            windowLength = ring ? ring : windowRecords;
+            if (ftruncate(fd, dataOffset + windowLength * sizeof(Record))) {
+                close();
+                return false;
+            }
+            void *page = mmap(nullptr, sizeof(Header), PROT_READ | PROT_WRITE,
+                              MAP_SHARED, fd, 0);
+            if (page == MAP_FAILED) {
+                close();
+                return false;
+            }
+            header = static_cast<Header *>(page);
+            memcpy(header->magic, magic, sizeof(magic));
+            header->ring = ring;
+            header->appended = 0;
+            strncpy(header->source, source.c_str(), sizeof(header->source) - 1);
+            if (!map()) {
+                close();
+                return false;
+            }
+            return true;
+        }
+
+        bool isOpen() const { return fd >= 0; }
+
+        void
+        append(Event event, uint8_t thread, uint64_t key, uint32_t value,
+               uint16_t extra = 0)
+        {
+            uint64_t next = header->appended;
+            if (next - windowStart == windowLength && !advance()) {
+                return;
+            }
+            Record &record = window[next - windowStart];
+            record.key = key;
+            record.value = value;
+            record.extra = extra;
+            record.thread = thread;
+            record.event = event;
+            header->appended = next + 1;
+        }
+
+        /**
+         * Unmaps the trace and trims a growing trace to its records.
+         */
+        void
+        close()
+        {
+            if (fd < 0) {
+                return;
+            }
+            uint64_t appended = header ? header->appended : 0;
+            if (window) {
+                munmap(window, windowLength * sizeof(Record));
+                window = nullptr;
+            }
+            if (header) {
+                munmap(header, sizeof(Header));
+                header = nullptr;
+            }
+            if (!ring && ftruncate(fd, dataOffset + appended * sizeof(Record))) {
+                // Trimming failed, the reader ignores the unused tail anyway
+            }
+            ::close(fd);
+            fd = -1;
+        }
+
+    private:
+        bool
+        map()
+        {
+            void *data = mmap(nullptr, windowLength * sizeof(Record),
+                              PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                              dataOffset + (ring ? 0 : windowStart * sizeof(Record)));
+            if (data == MAP_FAILED) {
+                window = nullptr;
+                return false;
+            }
+            window = static_cast<Record *>(data);
+            return true;
+        }
+
+        /**
+         * Moves the window past its last record: a ring wraps around onto
+         * the same mapping, a growing trace extends the file and maps the
+         * next window.
+         * @return False if the trace could not grow, it is closed then.
+         */
+        bool
+        advance()
+        {
+            windowStart += windowLength;
+            if (ring) {
+                return true;
+            }
+            munmap(window, windowLength * sizeof(Record));
+            window = nullptr;
+            if (ftruncate(fd, dataOffset + (windowStart + windowLength) * sizeof(Record)) ||
+                !map()) {
+                close();        // Out of disk or address space, keep what was traced
+                return false;
+            }
+            return true;
+        }
+
+        int fd;
+        Header *header;             // Mapped header page
+        Record *window;             // Mapped records, windowLength of them
+        uint64_t windowStart;       // Number of the first record in the window
+        uint64_t windowLength;
+        uint64_t ring;
+};
+
+/**
+ * Read-only view of a whole trace file, mapped into memory.
+ */
+class Reader
+{
+    public:
+        Reader() : base(nullptr), length(0) {}
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+        ~Reader() { if (base) munmap(base, length); }
+
+        /**
+         * Maps a trace file and checks its header.
+         * @return An error message, empty on success.
+         */
+        std::string
+        open(const std::string &path)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                return path + ": cannot open";
+            }
+            struct stat st;
+            fstat(fd, &st);
+            length = st.st_size;
+            if (length < dataOffset) {
+                ::close(fd);
+                return path + ": too short for an event trace";
+            }
+            base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (base == MAP_FAILED) {
+                base = nullptr;
+                return path + ": cannot map";
+            }
+            if (memcmp(header().magic, magic, sizeof(magic))) {
+                return path + ": not an event trace";
+            }
+            return "";
+        }
+
+        const Header &header() const { return *static_cast<const Header *>(base); }
+
+        /**
+         * @return Number of records held, the newest ones for a ring.
+         */
+        uint64_t
+        size() const
+        {
+            uint64_t stored = (length - dataOffset) / sizeof(Record);
+            uint64_t appended = header().appended;
+            if (header().ring) {
+                appended = appended < header().ring ? appended : header().ring;
+            }
+            return appended < stored ? appended : stored;
+        }
+
+        /**
+         * @return The i-th oldest record held.
+         */
+        const Record &
+        operator[](uint64_t i) const
+        {
+            const Record *records = reinterpret_cast<const Record *>(
+                static_cast<const char *>(base) + dataOffset);
+            uint64_t ring = header().ring;
+            if (ring && header().appended > ring) {
+                return records[(header().appended - ring + i) % ring];
+            }
+            return records[i];
+        }
+
+    private:
+        void *base;
+        size_t length;
+};
+
+} // namespace EventTrace
+
+#endif // __BASE_EVENT_TRACE_HH__
@@ -0,0 +1,170 @@
+/**
+ * Decoder for the binary event traces written by GSelectBP and LRUIPVRP
+ * when their eventTrace parameter is set.
+ *
+ * Build the tool from the root of the gem5 tree:
+ *     g++ -O2 -std=c++14 -Isrc util/event_trace_decode.cc \
+ *         -o event_trace_decode
+ *
+ * Usage:
+ *     event_trace_decode [-s] [-e events] [-n records] trace...
+ * Prints one line per record, oldest first, or with -s only the number of
+ * records of each event. -e keeps the comma separated events given, by the
+ * names printed, e.g. gselect.update,lruipv.victim, and -n stops after
+ * that many records per trace.
+ */
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "base/event_trace.hh"
+
+namespace
+{
+
+void
+print(uint64_t index, const EventTrace::Record &record)
+{
+    const char *name = record.event < EventTrace::NumEvents ?
+        EventTrace::eventNames[record.event] : "unknown";
+    printf("%10" PRIu64 " %-18s tid %u ", index, name, record.thread);
+    switch (record.event) {
+      case EventTrace::GSelectLookup:
+        printf("pc %#" PRIx64 " index %u predict %s\n", record.key,
+               record.value, record.extra ? "taken" : "not taken");
+        break;
+      case EventTrace::GSelectUncond:
+        printf("pc %#" PRIx64 " history %#x\n", record.key, record.value);
+        break;
+      case EventTrace::GSelectUpdate:
+        printf("pc %#" PRIx64 " index %u %s%s\n", record.key, record.value,
+               record.extra & 1 ? "taken" : "not taken",
+               record.extra & 2 ? " squashed" : "");
+        break;
+      case EventTrace::GSelectSquash:
+        printf("history %#x\n", record.value);
+        break;
+      case EventTrace::LRUIPVTouch:
+        printf("set %" PRIu64 " way %u position %u -> %u\n", record.key,
+               record.value, record.extra >> 8, record.extra & 0xFF);
+        break;
+      case EventTrace::LRUIPVReset:
+        printf("set %" PRIu64 " way %u inserted at %u with ipv%u\n",
+               record.key, record.value, record.extra >> 8,
+               record.extra & 0xFF);
+        break;
+      case EventTrace::LRUIPVVictim:
+        printf("set %" PRIu64 " way %u %s\n", record.key, record.value,
+               record.extra ? "valid" : "invalid");
+        break;
+      case EventTrace::LRUIPVInvalidate:
+        printf("set %" PRIu64 " way %u\n", record.key, record.value);
+        break;
+      default:
+        printf("key %#" PRIx64 " value %#x extra %#x\n", record.key,
+               record.value, record.extra);
+        break;
+    }
+}
+
+void
+usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-s] [-e events] [-n records] trace...\n",
+            name);
+    exit(1);
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char **argv)
+{
+    bool summary = false;
+    std::vector<bool> shown(EventTrace::NumEvents, true);
+    uint64_t limit = UINT64_MAX;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg[0] != '-') {
+            paths.push_back(arg);
+        } else if (arg == "-s") {
+            summary = true;
+        } else if (arg == "-e" && i + 1 < argc) {
+            shown.assign(EventTrace::NumEvents, false);
+            std::string list(argv[++i]);
+            size_t start = 0;
+            while (start <= list.size()) {
+                size_t end = list.find(',', start);
+                if (end == std::string::npos) {
+                    end = list.size();
+                }
+                std::string name = list.substr(start, end - start);
+                bool known = false;
+                for (unsigned event = 0; event < EventTrace::NumEvents; event++) {
+                    if (name == EventTrace::eventNames[event]) {
+                        shown[event] = known = true;
+                    }
+                }
+                if (!known) {
+                    fprintf(stderr, "unknown event %s\n", name.c_str());
+                    return 1;
+                }
+                start = end + 1;
+            }
+        } else if (arg == "-n" && i + 1 < argc) {
+            limit = std::stoull(argv[++i]);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (paths.empty()) {
+        usage(argv[0]);
+    }
+
+    for (const std::string &path : paths) {
+        EventTrace::Reader trace;
+        std::string error = trace.open(path);
+        if (!error.empty()) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        const EventTrace::Header &header = trace.header();
+        printf("# %s: %.*s, %" PRIu64 " records appended, %" PRIu64 " held%s\n",
+               path.c_str(), (int)sizeof(header.source), header.source,
+               header.appended, trace.size(), header.ring ? " (ring)" : "");
+
+        // Index of the first record held, records before it were
+        // overwritten by a ring
+        uint64_t first = header.appended - trace.size();
+        std::vector<uint64_t> counts(EventTrace::NumEvents + 1, 0);
+        uint64_t printed = 0;
+        for (uint64_t i = 0; i < trace.size() && printed < limit; i++) {
+            const EventTrace::Record &record = trace[i];
+            unsigned event = record.event < EventTrace::NumEvents ?
+                unsigned(record.event) : unsigned(EventTrace::NumEvents);
+            if (event < EventTrace::NumEvents && !shown[event]) {
+                continue;
+            }
+            counts[event]++;
+            printed++;
+            if (!summary) {
+                print(first + i, record);
+            }
+        }
+        if (summary) {
+            for (unsigned event = 0; event <= EventTrace::NumEvents; event++) {
+                if (counts[event]) {
+                    printf("%-18s %" PRIu64 "\n", event < EventTrace::NumEvents ?
+                           EventTrace::eventNames[event] : "unknown",
+                           counts[event]);
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -1,32 +1,79 @@
 #include "cpu/pred/gselect.hh"
+
+#include <algorithm>
+
 #include "base/intmath.hh"
+#include "base/output.hh"
 
 GSelectBP::GSelectBP(const GSelectBPParams *params)           // Default constructor
     : BPredUnit(params),
-    globalHistoryReg(params->numThreads, 0),                  // Assigning the size of global history register vector to number of threads
-    CounterCtrBits(params->CounterCtrBits),                   
-    CounterPredictorSize(params->CounterPredictorSize),
-    globalHistoryBits(params->globalHistoryBits),
-    counters(CounterPredictorSize, SatCounter(CounterCtrBits)) // Assigning the predictor counter's vector variable with CounterPredictorSize and initialzing saturation counter.
-
+    core(params->CounterPredictorSize, params->CounterCtrBits,  // Counter table and one global history register per thread
+         params->globalHistoryBits, params->instShiftAmt, params->numThreads),
+    historyRings("GSelect", params->numThreads, params->historyCheckpoints), // One ring of history checkpoints per thread
+    detailedStats(params->detailedStats),
+    touched(params->CounterPredictorSize, false),
+    lastBranch(params->detailedStats ? params->CounterPredictorSize : 0, 0),  // Only paid for when aliasing is tracked
+    gselectStats(*this, params->topMispredictedBranches),
+    confidence(params->confidenceTableSize, params->confidenceCtrBits, 0),
+    confidenceThreshold(params->confidenceThreshold),
+    gatingThreshold(params->gatingThreshold),
+    lastLowConfidence(params->numThreads, false),
+    lowConfidenceInFlight(params->numThreads, 0),
+    confidenceStats(*this)
 {
-    DPRINTF(GSelect,"globalHistoryBits=%u\n",globalHistoryBits);
-    DPRINTF(GSelect,"CounterCtrBits=%u\n",CounterCtrBits);
-    DPRINTF(GSelect,"CounterPredictorSize=%u",CounterPredictorSize);
+    DPRINTF(GSelect,"globalHistoryBits=%u\n",params->globalHistoryBits);
+    DPRINTF(GSelect,"CounterCtrBits=%u\n",params->CounterCtrBits);
+    DPRINTF(GSelect,"CounterPredictorSize=%u",params->CounterPredictorSize);
     /* Check if the size of predictor table is a power of 2 or not */
-    if(!isPowerOf2(CounterPredictorSize)) {
+    if(!isPowerOf2(params->CounterPredictorSize)) {
         fatal("Invalid local predictor size!\n");
     }
 
-    n = ceilLog2(CounterPredictorSize);
-    DPRINTF(GSelect,"ceil of CounterPredictorSize: %u \n",n);
-    n = n - globalHistoryBits;                                  // Calculating the number of bits of branch addres to consider
-    DPRINTF(GSelect,"Size of n: %u \n",n);
-    programCounterMask = mask(n);                               // Generating the mask for branch address
-    
-    historyRegisterMask = mask(globalHistoryBits);              // Generating the mask for global history register
+    /* The global history has to fit in the index */
+    if(!GSelectCore::validConfig(params->CounterPredictorSize, params->CounterCtrBits, params->globalHistoryBits)) {
+        fatal("Invalid GSelect counter bits or global history bits!\n");
+    }
+
+    /* Confidence counters are indexed like gshare, without a table only the counter saturation is used */
+    if(params->confidenceTableSize && !isPowerOf2(params->confidenceTableSize)) {
+        fatal("Invalid GSelect confidence table size!\n");
+    }
+    if(params->confidenceCtrBits < 1 || params->confidenceCtrBits > 8 ||
+       params->confidenceThreshold > (1u << params->confidenceCtrBits) - 1) {
+        fatal("Invalid GSelect confidence counter bits or threshold!\n");
+    }
+
+    DPRINTF(GSelect,"Size of n: %u \n",core.n);
+
+    /* Record the committed branch stream for offline replay */
+    if(!params->branchTrace.empty() &&
+       !branchTrace.open(simout.resolve(params->branchTrace), params->instShiftAmt)) {
+        fatal("Cannot create GSelect branch trace %s\n", params->branchTrace);
+    }
 
-    indexMask = mask(n+globalHistoryBits);                      // Generating the mask for final index of predictor table
+    /* Binary trace of the predictor's events, cheap enough for whole runs */
+    if(!params->eventTrace.empty() &&
+       !eventTrace.open(simout.resolve(params->eventTrace), name(), params->eventTraceRing)) {
+        fatal("Cannot create GSelect event trace %s\n", params->eventTrace);
+    }
+
+    /* Train the counters and global histories with a recorded branch stream before simulating, e.g. the one of a fast-forward */
+    if(!params->warmupTrace.empty()) {
+        GSelectTrace::Reader trace;
+        std::string error = trace.open(params->warmupTrace);
+        fatal_if(!error.empty(), "Cannot read GSelect warm-up trace: %s\n", error);
+        fatal_if(trace.header().instShiftAmt != params->instShiftAmt,
+                 "GSelect warm-up trace was recorded with instShiftAmt %u, not %u\n",
+                 trace.header().instShiftAmt, params->instShiftAmt);
+        const uint64_t *records = trace.records();
+        fatal_if(std::any_of(records, records + trace.size(),
+                             [&](uint64_t record) { return GSelectTrace::tid(record) >= params->numThreads; }),
+                 "GSelect warm-up trace has branches of more than %u threads\n", params->numThreads);
+        GSelectCore::BatchResult result;
+        core.replayBatch(records, trace.size(), result);
+        inform("GSelect warmed up with %lu branches, %lu of %lu conditional branches mispredicted\n",
+               trace.size(), result.condIncorrect, result.condPredicted);
+    }
 }
 
 /**
@@ -38,20 +85,31 @@ GSelectBP::GSelectBP(const GSelectBPParams *params)           // Default constru
  */
 bool GSelectBP::lookup(ThreadID tid, Addr branch_addr, void * &bp_history)
 {
-    bool taken;                                                                 // Variable to store and return the prediction obtained from prediction table
     DPRINTF(GSelect,"lookup \n");
-    unsigned globalHistory = globalHistoryReg[tid];                             // Fetch the global history from global history register
-    unsigned index = getIndex(branch_addr, programCounterMask, globalHistory);  // Generate index based on global history and branch address
-    uint8_t counter_val = counters[index];                                      // Get the counter value from the predictor table
-    
-    BPHistory *history = new BPHistory;                                         // Create a new history for the case of squash
-    history->globalHistoryReg = globalHistoryReg[tid];                          // Store the new history
-    bp_history = static_cast<void*>(history);                                   // Assign the address of bp_history to the new history created
+    BPHistory *history = takeCheckpoint(tid);                                   // Checkpoint the history for the case of squash
+    bp_history = static_cast<void*>(history);                                   // Assign the address of bp_history to the checkpoint taken
+
+    bool taken = core.lookup(tid, branch_addr, history->globalHistoryReg);      // Predict and shift the prediction into the global history register
+    history->predTaken = taken;
 
-    taken = getPrediction(counter_val);                                         // Get the prediction based on the counter value        
+    /* Weak counters and recently mispredicted confidence entries make a prediction low confidence */
+    uint8_t count = core.counters.read(core.getIndex(branch_addr, history->globalHistoryReg));
+    bool saturated = count == 0 || count == core.counters.max();
+    history->lowConfidence = !saturated ||
+        (confidence.size() && confidence.read(confidenceIndex(branch_addr, history->globalHistoryReg)) < confidenceThreshold);
+    history->unresolved = history->lowConfidence;
+    lowConfidenceInFlight[tid] += history->lowConfidence;
+    lastLowConfidence[tid] = history->lowConfidence;
+    if(eventTrace.isOpen())
+    {
+        eventTrace.append(EventTrace::GSelectLookup, tid, branch_addr,
+                          core.getIndex(branch_addr, history->globalHistoryReg), taken);
+    }
+    if(branchTrace.isOpen())                                                    // Whether the BTB knows the branch is only needed for replay
+    {
+        history->btbMiss = !BTB.valid(branch_addr, tid);
+    }
     DPRINTF(GSelect,"prediction = %d \n",taken);
-    updateGlobalHistReg(tid, taken);                                            // Update the global history table with the new prediction value
-    DPRINTF(GSelect,"exiting lookup \n");
     return taken;                                                               // Return the prediction
 }
 
@@ -65,8 +123,7 @@ bool GSelectBP::lookup(ThreadID tid, Addr branch_addr, void * &bp_history)
 void GSelectBP::btbUpdate(ThreadID tid, Addr branchAddr, void * &bpHistory)
 {
     DPRINTF(GSelect,"btbUpdate \n");
-    globalHistoryReg[tid] &= (historyRegisterMask & ~ULL(1));     // Update the global history register with not taken value
-    DPRINTF(GSelect,"exiting btbUpdate \n");
+    core.btbUpdate(tid);                                        // Update the global history register with not taken value
 }
 
 /**
@@ -80,38 +137,61 @@ void GSelectBP::update(ThreadID tid, Addr branch_addr, bool taken, void *bp_hist
 {
     assert(bp_history);                                       // Check if bp_history is null, if it is null then generate error. 
 
-    BPHistory *history = static_cast<BPHistory*>(bp_history);  // Create a new history for the case of squash
+    BPHistory *history = static_cast<BPHistory*>(bp_history);  // Checkpoint taken when the branch was predicted
     
     DPRINTF(GSelect,"update \n");
+    // On a squash only the global history register is restored, the
+    // counters are not updated speculatively. The checkpoint stays in
+    // flight, the branch is committed later with squashed == false.
+    // On commit the counter the branch was predicted with is trained,
+    // younger branches have moved the global history register since.
+    core.update(tid, branch_addr, taken, history->globalHistoryReg, squashed);
+    if(eventTrace.isOpen())
+    {
+        eventTrace.append(EventTrace::GSelectUpdate, tid, branch_addr,
+                          core.getIndex(branch_addr, history->globalHistoryReg),
+                          taken | squashed << 1);
+    }
+    resolve(tid, history);                                                          // Resolved as mispredicted, or committing
     if (squashed) {
-        // We do not update the counters speculatively on a squash.
-        // We just restore the global history register.
-        globalHistoryReg[tid] = (history->globalHistoryReg << 1) | taken;
-        globalHistoryReg[tid] &= historyRegisterMask;
         DPRINTF(GSelect,"squashed \n");
         return;
     }
 
-
-    unsigned globalHistory = globalHistoryReg[tid];                                 // Fetch the global history from global history register
-    unsigned index = getIndex(branch_addr, programCounterMask, globalHistory);      // Generate index based on global history and branch address
-    DPRINTF(GSelect, "Looking up index %#x\n", index);
-
-    if(taken)                                                                       // If the update is taken, then increment the counter located at the index.
+    if(!inst->isUncondCtrl())                                                       // Confidence of conditional predictions
     {
-        DPRINTF(GSelect,"Branch updated as taken.\n");
-        counters[index]++;  
-    }   
-    else                                                                            // If the update is not taken, then decrement the counter located at the index.
+        bool correct = history->predTaken == taken;
+        if(history->lowConfidence) {
+            (correct ? confidenceStats.lowCorrect : confidenceStats.lowIncorrect)++;
+        } else {
+            (correct ? confidenceStats.highCorrect : confidenceStats.highIncorrect)++;
+        }
+        if(confidence.size()) {
+            unsigned index = confidenceIndex(branch_addr, history->globalHistoryReg);
+            if(correct) {
+                confidence.increment(index);
+            } else {
+                confidence.write(index, 0);                                         // Resetting counter
+            }
+        }
+    }
+    if(history->gated)
     {
-        DPRINTF(GSelect,"Branch updated as not taken.\n");
-        counters[index]--;
+        confidenceStats.gatedCorrectPath++;
     }
-    updateGlobalHistReg(tid, taken);                                                // Update the global history register with the updated value
 
-    delete history;                                                                 // Delete history
+    if(branchTrace.isOpen())                                                        // Record the committed branch for replay
+    {
+        uint64_t flags = (taken ? GSelectTrace::Taken : 0) |
+                         (inst->isUncondCtrl() ? GSelectTrace::Uncond : 0) |
+                         (history->btbMiss ? GSelectTrace::BTBMiss : 0) |
+                         (inst->isCall() || inst->isReturn() ? GSelectTrace::CallReturn : 0);
+        branchTrace.append(GSelectTrace::encode(branch_addr, tid, flags));
+    }
 
-    DPRINTF(GSelect,"exiting update \n");
+    recordCommit(branch_addr, core.getIndex(branch_addr, history->globalHistoryReg),
+                 taken, history, !inst->isUncondCtrl());
+    historyRings.commit(tid, history);
 }
 
 /**
@@ -124,13 +204,20 @@ void GSelectBP::squash(ThreadID tid, void *bp_history)
     if(bp_history==NULL)                       // If there is no history, then return.
     {
         DPRINTF(GSelect,"bpHistory==NULL \n");
-        DPRINTF(GSelect,"exiting squash \n");        
         return;
     }
     BPHistory *history = static_cast<BPHistory*>(bp_history);
-    globalHistoryReg[tid] = history->globalHistoryReg;        // Update the global history register with the history recorded before generating prediction in lookup.
-    delete history;
-    DPRINTF(GSelect,"exiting squash \n");
+    core.squash(tid, history->globalHistoryReg);               // Update the global history register with the history recorded before generating prediction in lookup.
+    if(eventTrace.isOpen())
+    {
+        eventTrace.append(EventTrace::GSelectSquash, tid, 0, history->globalHistoryReg);
+    }
+    resolve(tid, history);
+    if(history->gated)
+    {
+        confidenceStats.gatedWrongPath++;
+    }
+    historyRings.squash(tid, history);
 }
 
 /**
@@ -140,66 +227,211 @@ void GSelectBP::squash(ThreadID tid, void *bp_history)
  */
 void GSelectBP::uncondBranch(ThreadID tid, Addr pc, void * &bpHistory)
 {
-    BPHistory *history = new BPHistory;                                     // Create a new history for the case of squash
-    history->globalHistoryReg = globalHistoryReg[tid];                      // Store the new history
+    BPHistory *history = takeCheckpoint(tid);                               // Checkpoint the history for the case of squash
     DPRINTF(GSelect,"uncondBranch: Updating global history as taken.\n");   
-    bpHistory = static_cast<void*>(history);                                // Assign the address of bp_history to the new history created
-    updateGlobalHistReg(tid,1);                                             // Update the global history register with taken
-    DPRINTF(GSelect,"exiting uncondBranch \n");
+    bpHistory = static_cast<void*>(history);                                // Assign the address of bp_history to the checkpoint taken
+    core.uncondBranch(tid, history->globalHistoryReg);                      // Update the global history register with taken
+    history->predTaken = true;
+    if(eventTrace.isOpen())
+    {
+        eventTrace.append(EventTrace::GSelectUncond, tid, pc, history->globalHistoryReg, 1);
+    }
+    if(branchTrace.isOpen())
+    {
+        history->btbMiss = !BTB.valid(pc, tid);
+    }
 }
 
-/**
- *  Returns the taken/not taken prediction given the value of the
- *  counter.
- *  @param count The value of the counter.
- *  @return The prediction based on the counter value.
- */
-inline bool GSelectBP::getPrediction(uint8_t &count)            
+void GSelectBP::serialize(CheckpointOut &cp) const
 {
-    
-    DPRINTF(GSelect,"getPrediction \n");
-    return (count >> (CounterCtrBits - 1));          // Get the MSB of the count   
-    DPRINTF(GSelect,"exiting getPrediction \n");
+    historyRings.checkDrained();
+    /* Geometry the table was checkpointed with, checked on restore */
+    unsigned CounterPredictorSize = core.CounterPredictorSize;
+    unsigned CounterCtrBits = core.CounterCtrBits;
+    unsigned globalHistoryBits = core.globalHistoryBits;
+    SERIALIZE_SCALAR(CounterPredictorSize);
+    SERIALIZE_SCALAR(CounterCtrBits);
+    SERIALIZE_SCALAR(globalHistoryBits);
+
+    std::vector<uint64_t> counters = core.counters.saveWords();     // Packed, a quarter byte per 2-bit counter
+    SERIALIZE_CONTAINER(counters);
+    const std::vector<unsigned> &globalHistoryReg = core.globalHistoryReg;
+    SERIALIZE_CONTAINER(globalHistoryReg);
+    unsigned confidenceTableSize = confidence.size();
+    unsigned confidenceCtrMax = confidence.max();
+    SERIALIZE_SCALAR(confidenceTableSize);
+    SERIALIZE_SCALAR(confidenceCtrMax);
+    std::vector<uint64_t> confidenceCounters = confidence.saveWords();
+    SERIALIZE_CONTAINER(confidenceCounters);
+}
+
+void GSelectBP::unserialize(CheckpointIn &cp)
+{
+    unsigned CounterPredictorSize, CounterCtrBits, globalHistoryBits;
+    UNSERIALIZE_SCALAR(CounterPredictorSize);
+    UNSERIALIZE_SCALAR(CounterCtrBits);
+    UNSERIALIZE_SCALAR(globalHistoryBits);
+    fatal_if(CounterPredictorSize != core.CounterPredictorSize ||
+             CounterCtrBits != core.CounterCtrBits ||
+             globalHistoryBits != core.globalHistoryBits,
+             "GSelect checkpoint has %u %u-bit counters and %u history bits, "
+             "the predictor %u %u-bit counters and %u history bits\n",
+             CounterPredictorSize, CounterCtrBits, globalHistoryBits,
+             core.CounterPredictorSize, core.CounterCtrBits, core.globalHistoryBits);
+
+    std::vector<uint64_t> counters;
+    UNSERIALIZE_CONTAINER(counters);
+    fatal_if(!core.counters.restoreWords(counters), "GSelect checkpoint counter table is corrupt\n");
+    std::vector<unsigned> globalHistoryReg;
+    UNSERIALIZE_CONTAINER(globalHistoryReg);
+    fatal_if(globalHistoryReg.size() != core.globalHistoryReg.size(),
+             "GSelect checkpoint has %u threads, the predictor %u\n",
+             globalHistoryReg.size(), core.globalHistoryReg.size());
+    core.globalHistoryReg = globalHistoryReg;
+
+    /* Checkpoints taken before the confidence table leave it cold */
+    unsigned confidenceTableSize, confidenceCtrMax;
+    if(!UNSERIALIZE_OPT_SCALAR(confidenceTableSize))
+    {
+        return;
+    }
+    UNSERIALIZE_SCALAR(confidenceCtrMax);
+    fatal_if(confidenceTableSize != confidence.size() || confidenceCtrMax != confidence.max(),
+             "GSelect checkpoint has %u confidence counters up to %u, the predictor %u up to %u\n",
+             confidenceTableSize, confidenceCtrMax, confidence.size(), (unsigned)confidence.max());
+    std::vector<uint64_t> confidenceCounters;
+    UNSERIALIZE_CONTAINER(confidenceCounters);
+    fatal_if(!confidence.restoreWords(confidenceCounters), "GSelect checkpoint confidence table is corrupt\n");
 }
 
 /**
- *  Returns the index of the predictor table given the value of the
- *  program counter and global history.
- *  @param branch_addr The address of the branch.
- *  @param programCounterMask The mask to determine how many bits of branch_addr to consider.
- *  @param globalHistory Global history register's value.
- *  @return The index of the predictor table.
+ * Takes a new checkpoint slot at the tail of the thread's ring, the caller
+ * fills in the global history register.
+ * @return The checkpoint, used as the bp_history of the branch.
  */
-unsigned GSelectBP::getIndex(Addr &branch_addr, unsigned programCounterMask, unsigned globalHistory)
+GSelectBP::BPHistory *GSelectBP::takeCheckpoint(ThreadID tid)
 {
-    DPRINTF(GSelect,"getIndex \n");
-    unsigned index;
-    DPRINTF(GSelect,"programCounterMask=%u \t globalHistory = %u \t branch_addr= %u \n",programCounterMask,globalHistory,branch_addr);
-    unsigned temp = (branch_addr >> instShiftAmt) & programCounterMask;   // Right shift the branch address by instShiftAmt(2) to remove 00 (because of word addressable addresses)
-    DPRINTF(GSelect,"branch_addr >> 2 = %u \n",temp);
-    index = (temp << globalHistoryBits) | globalHistory;        // Left shift the branch address by the number of bits in global history register and then concatenate it with global history
-    index &= indexMask;                                         // Mask the index so that result contains m+n bits only.
-    DPRINTF(GSelect,"exiting getIndex \n");
-    return index; 
+    BPHistory *history = historyRings.take(tid);
+    history->btbMiss = false;
+    history->lowConfidence = false;
+    history->unresolved = false;
+    history->gated = gateFetch(tid);            // Fetch would not have reached this branch yet
+    if(history->gated)
+    {
+        confidenceStats.gatedBranches++;
+    }
+    return history;
+}
+
+void GSelectBP::resolve(ThreadID tid, BPHistory *history)
+{
+    if(history->unresolved)
+    {
+        lowConfidenceInFlight[tid]--;
+        history->unresolved = false;
+    }
 }
 
 /**
- * Updates the global history register with parameter value taken.
- * a true/false value as to whether it is taken.
- * @param branch_addr The address of the branch to look up.
- * @param taken Whether or not the branch was taken.
+ * Accounts a committed branch in the stats.
+ * @param index Table entry the branch was predicted and trained with.
+ * @param conditional Whether the branch is conditional.
  */
-void GSelectBP::updateGlobalHistReg(ThreadID tid, bool taken)
+void GSelectBP::recordCommit(Addr branch_addr, unsigned index, bool taken,
+                             const BPHistory *history, bool conditional)
 {
-    DPRINTF(GSelect,"updateGlobalHistory \n");
-    DPRINTF(GSelect,"TID: %d \t TAKEN=%d \n",tid,taken);
-    globalHistoryReg[tid] = taken ? (globalHistoryReg[tid] << 1) | 1 : (globalHistoryReg[tid] << 1);  // Left shift the global history register and or it with 1 if taken is true.
-    globalHistoryReg[tid] &= historyRegisterMask;
-    DPRINTF(GSelect,"exiting updateGlobalHistory \n");
+    touched[index] = true;
+    if(!detailedStats)
+    {
+        return;
+    }
+    bool mispredicted = conditional && history->predTaken != taken;
+    if(lastBranch[index] != 0 && lastBranch[index] != branch_addr)     // Another branch trained this counter last
+    {
+        gselectStats.aliasedUpdates++;
+        if(mispredicted) {
+            gselectStats.destructiveAliasing++;
+        }
+    }
+    lastBranch[index] = branch_addr;
+    if(mispredicted) {
+        branchMispredicts[branch_addr]++;
+    }
+}
+
+GSelectBP::GSelectStats::GSelectStats(GSelectBP &parent, unsigned topBranches)
+    : Stats::Group(&parent, "gselect"),
+      gselect(parent),
+      ADD_STAT(aliasedUpdates, "Number of committed branches that trained a counter last trained by another branch"),
+      ADD_STAT(destructiveAliasing, "Number of aliased updates whose branch was mispredicted"),
+      ADD_STAT(counterStates, "Number of counters holding each value"),
+      ADD_STAT(touchedEntries, "Number of counters trained at least once"),
+      ADD_STAT(utilization, "Fraction of the counters trained at least once"),
+      ADD_STAT(topMispredictPCs, "Addresses of the most mispredicted conditional branches"),
+      ADD_STAT(topMispredicts, "Mispredictions of the most mispredicted conditional branches")
+{
+    counterStates.init(parent.core.counters.max() + 1).flags(Stats::total | Stats::pdf);
+    for (unsigned value = 0; value <= parent.core.counters.max(); value++) {
+        counterStates.subname(value, std::to_string(value));
+    }
+    utilization = touchedEntries / Stats::constant(parent.core.counters.size());
+    fatal_if(topBranches == 0, "GSelect needs to report at least one mispredicted branch!\n");
+    topMispredictPCs.init(topBranches);
+    topMispredicts.init(topBranches);
+}
+
+void GSelectBP::GSelectStats::preDumpStats()
+{
+    Stats::Group::preDumpStats();
+
+    /* Snapshot of the counter table */
+    const PackedCounterTable &counters = gselect.core.counters;
+    std::vector<Counter> states(counters.max() + 1, 0);
+    for (size_t index = 0; index < counters.size(); index++) {
+        states[counters.read(index)]++;
+    }
+    for (unsigned value = 0; value < states.size(); value++) {
+        counterStates[value] = states[value];
+    }
+    touchedEntries = std::count(gselect.touched.begin(), gselect.touched.end(), true);
+
+    /* Most mispredicted branches first, ties by address so the report is stable */
+    std::vector<std::pair<Addr, Counter>> branches(gselect.branchMispredicts.begin(),
+                                                   gselect.branchMispredicts.end());
+    size_t reported = std::min<size_t>(branches.size(), topMispredicts.size());
+    std::partial_sort(branches.begin(), branches.begin() + reported, branches.end(),
+                      [](const std::pair<Addr, Counter> &a, const std::pair<Addr, Counter> &b) {
+                          return a.second > b.second || (a.second == b.second && a.first < b.first);
+                      });
+    for (size_t rank = 0; rank < topMispredicts.size(); rank++) {
+        topMispredictPCs[rank] = rank < reported ? branches[rank].first : 0;
+        topMispredicts[rank] = rank < reported ? branches[rank].second : 0;
+    }
+}
+
+void GSelectBP::GSelectStats::resetStats()
+{
+    Stats::Group::resetStats();
+    gselect.branchMispredicts.clear();      // The table keeps its contents, the per branch counts restart
+}
+
+GSelectBP::ConfidenceStats::ConfidenceStats(GSelectBP &parent)
+    : Stats::Group(&parent, "confidence"),
+      ADD_STAT(highCorrect, "Number of committed conditional branches predicted right with high confidence"),
+      ADD_STAT(highIncorrect, "Number of committed conditional branches predicted wrong with high confidence"),
+      ADD_STAT(lowCorrect, "Number of committed conditional branches predicted right with low confidence"),
+      ADD_STAT(lowIncorrect, "Number of committed conditional branches predicted wrong with low confidence"),
+      ADD_STAT(coverage, "Fraction of the mispredictions predicted with low confidence"),
+      ADD_STAT(lowConfidenceAccuracy, "Fraction of the low confidence predictions that were wrong"),
+      ADD_STAT(gatedBranches, "Number of branches predicted while fetch would have been gated"),
+      ADD_STAT(gatedWrongPath, "Number of gated branches that were squashed, on the wrong path"),
+      ADD_STAT(gatedCorrectPath, "Number of gated branches that committed, on the correct path")
+{
+    coverage = lowIncorrect / (lowIncorrect + highIncorrect);
+    lowConfidenceAccuracy = lowIncorrect / (lowCorrect + lowIncorrect);
 }
 
 GSelectBP* GSelectBPParams::create()
 {
     return new GSelectBP(this);
 }
-
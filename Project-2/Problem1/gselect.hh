@@ -1,10 +1,18 @@
 #ifndef __CPU_PRED_GSELECT_HH__
 #define __CPU_PRED_GSELECT_HH__
 
-#include "base/sat_counter.hh"
+#include <unordered_map>
+#include <vector>
+
+#include "base/event_trace.hh"
+#include "base/statistics.hh"
 #include "base/types.hh"
 #include "cpu/pred/bpred_unit.hh"
+#include "cpu/pred/gselect_core.hh"
+#include "cpu/pred/gselect_trace.hh"
+#include "cpu/pred/history_ring.hh"
 #include "params/GSelectBP.hh"
+#include "sim/serialize.hh"
 #include "debug/GSelect.hh"
 
 class GSelectBP : public BPredUnit
@@ -56,53 +64,168 @@ class GSelectBP : public BPredUnit
          */
         bool lookup(ThreadID tid, Addr branch_addr, void * &bp_history);
 
-    private: 
         /**
-         * Updates the global history register with parameter value taken.
-         * a true/false value as to whether it is taken.
-         * @param branch_addr The address of the branch to look up.
-         * @param taken Whether or not the branch was taken.
+         * @return Whether the thread's last conditional prediction was of
+         * low confidence: its counter was not saturated, or the branches
+         * predicted with its confidence counter were recently mispredicted.
          */
-        void updateGlobalHistReg(ThreadID tid, bool taken);
+        bool lowConfidence(ThreadID tid) const { return lastLowConfidence[tid]; }
 
         /**
-         *  Returns the taken/not taken prediction given the value of the
-         *  counter.
-         *  @param count The value of the counter.
-         *  @return The prediction based on the counter value.
+         * @return Number of the thread's low confidence branches that
+         * have been predicted and are neither resolved as mispredicted nor
+         * committed or squashed. BPredUnit only reports a correct
+         * prediction when the branch commits, so a correctly predicted
+         * branch stays counted until then, not only until it executes.
          */
-        inline bool getPrediction(uint8_t &count);
+        unsigned lowConfidenceBranches(ThreadID tid) const { return lowConfidenceInFlight[tid]; }
 
         /**
-         *  Returns the index of the predictor table given the value of the
-         *  program counter and global history.
-         *  @param branch_addr The address of the branch.
-         *  @param programCounterMask The mask to determine how many bits of branch_addr to consider.
-         *  @param globalHistory Global history register's value.
-         *  @return The index of the predictor table.
+         * Pipeline gating signal for fetch: true while gatingThreshold or
+         * more low confidence branches are unresolved, when fetching more
+         * is likely wasted on the wrong path. Never true with a
+         * gatingThreshold of 0. The O3 fetch stage stalls the thread on it
+         * when its fetchGating parameter is set.
+         *
+         * Since correct low confidence branches are counted until they
+         * commit (see lowConfidenceBranches()), the count covers the whole
+         * reorder buffer rather than the branches still waiting to execute,
+         * and the signal stays raised longer than pipeline gating at
+         * execute would. Pick gatingThreshold above the number of low
+         * confidence branches the reorder buffer usually holds, or fetch
+         * is throttled on the correct path as well.
          */
-        inline unsigned getIndex(Addr &branch_addr, unsigned programCounterMask, unsigned globalHistory);
+        bool
+        gateFetch(ThreadID tid) const override
+        {
+            return gatingThreshold && lowConfidenceInFlight[tid] >= gatingThreshold;
+        }
 
+        /**
+         * Checkpoints the counter table and the global history registers.
+         * Only taken while drained, with no branch in flight.
+         */
+        void serialize(CheckpointOut &cp) const override;
+
+        /**
+         * Restores the counter table and the global history registers of a
+         * predictor with the same size, counter bits and history bits.
+         */
+        void unserialize(CheckpointIn &cp) override;
+
+    private: 
         /* Branch prediction history structure to hold the value of global history register in case the prediction get's squashed.  */
         struct BPHistory {
             unsigned globalHistoryReg;
+            bool predTaken;                         // Direction the counter predicted, taken for unconditional branches
+            bool btbMiss;                           // The BTB had no entry for the branch, only tracked while tracing
+            bool lowConfidence;                     // Predicted with low confidence
+            bool unresolved;                        // Counted in lowConfidenceInFlight
+            bool gated;                             // Predicted while gateFetch() was true
         };
 
-        /* Size of local Predictor */    
-        unsigned CounterPredictorSize;
+        /**
+         * @return Entry of the confidence table for a branch and the
+         * global history it was predicted with.
+         */
+        unsigned
+        confidenceIndex(Addr branch_addr, unsigned globalHistory) const
+        {
+            return ((branch_addr >> core.instShiftAmt) ^ globalHistory) & (confidence.size() - 1);
+        }
 
-        /* Size of counter bits */ 
-        unsigned CounterCtrBits;
+        /**
+         * Takes a low confidence branch out of lowConfidenceInFlight once
+         * it is resolved, committed or squashed.
+         */
+        void resolve(ThreadID tid, BPHistory *history);
 
-        /* Size of global Predictor */ 
-        unsigned globalHistoryBits;
-        
-        unsigned n;                                 // Branch address bits to be considered for indexing predictor table 
-        unsigned programCounterMask;                // Mask to determine how many bits of branch_addr to consider.
-        unsigned historyRegisterMask;               // Mask to determine how many bits of globalHistoryReg to consider.
-        unsigned indexMask;                         // Mask to determine how many bits of concatenated index to consider.
-        std::vector<SatCounter> counters;           // Vector to store the predictions
-        std::vector<unsigned> globalHistoryReg;     // Global History Register
+        /**
+         * Takes a new checkpoint slot at the tail of the thread's ring, the
+         * caller fills in the global history register.
+         * @return The checkpoint, used as the bp_history of the branch.
+         */
+        BPHistory *takeCheckpoint(ThreadID tid);
+
+        /**
+         * Accounts a committed branch in the stats.
+         * @param index Table entry the branch was predicted and trained with.
+         * @param conditional Whether the branch is conditional.
+         */
+        void recordCommit(Addr branch_addr, unsigned index, bool taken,
+                          const BPHistory *history, bool conditional);
+
+        struct GSelectStats : public Stats::Group
+        {
+            /**
+             * @param topBranches Number of mispredicted branches reported.
+             */
+            GSelectStats(GSelectBP &parent, unsigned topBranches);
+
+            /** Computes the table snapshots and the top mispredicting branches */
+            void preDumpStats() override;
+
+            void resetStats() override;
+
+            GSelectBP &gselect;
+
+            /** Committed branches trained an entry last trained by another branch */
+            Stats::Scalar aliasedUpdates;
+            /** Aliased updates whose branch was mispredicted */
+            Stats::Scalar destructiveAliasing;
+            /** Table entries holding each counter value */
+            Stats::Vector counterStates;
+            /** Table entries trained at least once */
+            Stats::Scalar touchedEntries;
+            /** Fraction of the table trained at least once */
+            Stats::Formula utilization;
+            /** Addresses of the conditional branches mispredicted most */
+            Stats::Vector topMispredictPCs;
+            /** Mispredictions of each of those branches */
+            Stats::Vector topMispredicts;
+        };
+
+        GSelectCore core;                           // Counter table, global history registers and indexing
+        HistoryRings<BPHistory> historyRings;       // Per-thread in-flight history checkpoints
+        GSelectTrace::Writer branchTrace;           // Committed branch stream, only open when requested
+        EventTrace::Writer eventTrace;              // Binary trace of lookups, updates and squashes, only open when requested
+
+        const bool detailedStats;                   // Track aliasing and per branch mispredictions, costs memory per table entry
+        std::vector<bool> touched;                  // Table entries trained at least once
+        std::vector<Addr> lastBranch;               // Branch that last trained each table entry, only with detailedStats
+        std::unordered_map<Addr, Counter> branchMispredicts; // Mispredictions per conditional branch, only with detailedStats
+        GSelectStats gselectStats;
+
+        struct ConfidenceStats : public Stats::Group
+        {
+            ConfidenceStats(GSelectBP &parent);
+
+            /** Committed conditional branches predicted with high confidence and right */
+            Stats::Scalar highCorrect;
+            /** Committed conditional branches predicted with high confidence but wrong */
+            Stats::Scalar highIncorrect;
+            /** Committed conditional branches predicted with low confidence and right */
+            Stats::Scalar lowCorrect;
+            /** Committed conditional branches predicted with low confidence but wrong */
+            Stats::Scalar lowIncorrect;
+            /** Fraction of the mispredictions flagged low confidence */
+            Stats::Formula coverage;
+            /** Fraction of the low confidence predictions that were wrong */
+            Stats::Formula lowConfidenceAccuracy;
+            /** Branches predicted while fetch would have been gated */
+            Stats::Scalar gatedBranches;
+            /** Gated branches that were squashed, fetched down the wrong path */
+            Stats::Scalar gatedWrongPath;
+            /** Gated branches that committed, fetch a gate would have delayed */
+            Stats::Scalar gatedCorrectPath;
+        };
+
+        PackedCounterTable confidence;              // Resetting counters: correct predictions since the last misprediction, saturating
+        const unsigned confidenceThreshold;         // Confidence counters below it make a prediction low confidence
+        const unsigned gatingThreshold;             // Uncommitted low confidence branches that gate fetch, 0 never gates
+        std::vector<bool> lastLowConfidence;        // Per thread, whether the last conditional prediction was low confidence
+        std::vector<unsigned> lowConfidenceInFlight; // Per thread, unresolved low confidence branches
+        ConfidenceStats confidenceStats;
         
 };
 
@@ -0,0 +1,247 @@
+#ifndef __CPU_PRED_GSELECT_CORE_HH__
+#define __CPU_PRED_GSELECT_CORE_HH__
+
+#include <cstdint>
+#include <vector>
+
+#include "cpu/pred/gselect_trace.hh"
+#include "cpu/pred/packed_counter_table.hh"
+
+/**
+ * State and prediction logic of the GSelect predictor: the table of
+ * saturating counters, the per-thread global history registers and the way
+ * branch addresses and history are concatenated into a table index.
+ *
+ * It has no dependency on the rest of gem5 so the same code drives both
+ * GSelectBP inside the simulator and the standalone trace replay tool.
+ * Checkpointing in-flight history is left to the caller, which passes the
+ * history a branch was predicted with back in on update and squash.
+ *
+ * replayBatch() runs a whole span of committed branches through the same
+ * logic without any of that bookkeeping, for replay and warm-up.
+ */
+class GSelectCore
+{
+    public:
+        /**
+         * @param CounterPredictorSize Number of counters, a power of 2.
+         * @param CounterCtrBits Bits per saturating counter.
+         * @param globalHistoryBits Bits of global history in the index.
+         * @param instShiftAmt Low branch address bits that are always 0.
+         * @param numThreads Number of global history registers.
+         */
+        GSelectCore(unsigned CounterPredictorSize, unsigned CounterCtrBits,
+                    unsigned globalHistoryBits, unsigned instShiftAmt,
+                    unsigned numThreads)
+            : CounterPredictorSize(CounterPredictorSize),
+              CounterCtrBits(CounterCtrBits),
+              globalHistoryBits(globalHistoryBits),
+              instShiftAmt(instShiftAmt),
+              counters(CounterPredictorSize, CounterCtrBits, 0), // Counters start at 0, like SatCounter
+              globalHistoryReg(numThreads, 0)
+        {
+            unsigned tableBits = 0;
+            while ((1u << tableBits) < CounterPredictorSize) {
+                tableBits++;
+            }
+            n = tableBits - globalHistoryBits;                  // Calculating the number of bits of branch addres to consider
+            programCounterMask = bitMask(n);                    // Generating the mask for branch address
+            historyRegisterMask = bitMask(globalHistoryBits);   // Generating the mask for global history register
+            indexMask = bitMask(n + globalHistoryBits);         // Generating the mask for final index of predictor table
+        }
+
+        /**
+         * @return Whether the parameters describe a usable predictor.
+         */
+        static bool
+        validConfig(unsigned CounterPredictorSize, unsigned CounterCtrBits,
+                    unsigned globalHistoryBits)
+        {
+            bool powerOf2 = CounterPredictorSize &&
+                !(CounterPredictorSize & (CounterPredictorSize - 1));
+            return powerOf2 && CounterCtrBits >= 1 && CounterCtrBits <= 8 &&
+                (1ull << globalHistoryBits) <= CounterPredictorSize;
+        }
+
+        /**
+         * Predicts a conditional branch and shifts the prediction into the
+         * thread's global history register.
+         * @param branch_addr The address of the branch to look up.
+         * @param history Set to the history the branch is predicted with.
+         * @return Whether or not the branch is predicted taken.
+         */
+        bool
+        lookup(unsigned tid, uint64_t branch_addr, unsigned &history)
+        {
+            history = globalHistoryReg[tid];
+            unsigned index = getIndex(branch_addr, history);
+            bool taken = getPrediction(counters.read(index));
+            updateGlobalHistReg(tid, taken);
+            return taken;
+        }
+
+        /**
+         * Shifts an unconditional, always taken branch into the thread's
+         * global history register.
+         * @param history Set to the history before the branch.
+         */
+        void
+        uncondBranch(unsigned tid, unsigned &history)
+        {
+            history = globalHistoryReg[tid];
+            updateGlobalHistReg(tid, true);
+        }
+
+        /**
+         * Turns the newest history bit into not taken, used when the BTB has
+         * no target for a branch predicted taken.
+         */
+        void
+        btbUpdate(unsigned tid)
+        {
+            globalHistoryReg[tid] &= (historyRegisterMask & ~1u);
+        }
+
+        /**
+         * Updates the predictor with the actual outcome of a branch.
+         * @param branch_addr The address of the branch.
+         * @param taken Whether or not the branch was taken.
+         * @param history The history the branch was predicted with.
+         * @param squashed True when the branch was mispredicted and the
+         * younger branches are being squashed: only the global history
+         * register is repaired, the counter is trained at commit.
+         */
+        void
+        update(unsigned tid, uint64_t branch_addr, bool taken,
+               unsigned history, bool squashed)
+        {
+            if (squashed) {
+                globalHistoryReg[tid] =
+                    ((history << 1) | taken) & historyRegisterMask;
+                return;
+            }
+            counters.update(getIndex(branch_addr, history), taken);
+        }
+
+        /**
+         * Counts of a batch of replayed branches.
+         */
+        struct BatchResult
+        {
+            uint64_t condPredicted = 0;
+            uint64_t condIncorrect = 0;
+            uint64_t uncondBranches = 0;
+        };
+
+        /**
+         * Predicts and trains a span of committed branches in order, the
+         * predictor seeing an ideal pipeline: each branch is looked up,
+         * repaired through the squash path if mispredicted and trained
+         * right away. A taken prediction for a branch the BTB missed,
+         * other than a call or return, is fetched as not taken.
+         *
+         * The state and counts match calling lookup() or uncondBranch(),
+         * btbUpdate() and update() per branch exactly, but each branch
+         * reads and trains its counter in one access and the history the
+         * squash path would restore is computed directly: whatever was
+         * predicted, the history ends with the outcome.
+         * @param records Branches in the GSelectTrace record format, their
+         * thread ids below the number of global history registers.
+         * @param result Incremented with the counts of the batch.
+         */
+        void
+        replayBatch(const uint64_t *records, size_t count, BatchResult &result)
+        {
+            unsigned *histories = globalHistoryReg.data();
+            for (size_t i = 0; i < count; i++) {
+                uint64_t record = records[i];
+                unsigned &globalHistory = histories[GSelectTrace::tid(record)];
+                bool taken = GSelectTrace::has(record, GSelectTrace::Taken);
+                bool uncond = GSelectTrace::has(record, GSelectTrace::Uncond);
+                unsigned index = getIndex(GSelectTrace::pc(record), globalHistory);
+                bool predicted = getPrediction(counters.readUpdate(index, taken));
+                // A BTB miss only matters to taken conditional predictions
+                predicted &= !GSelectTrace::has(record, GSelectTrace::BTBMiss) ||
+                             GSelectTrace::has(record, GSelectTrace::CallReturn);
+                result.condPredicted += !uncond;
+                result.condIncorrect += !uncond & (predicted != taken);
+                result.uncondBranches += uncond;
+                globalHistory = ((globalHistory << 1) | taken) & historyRegisterMask;
+            }
+        }
+
+        /**
+         * Restores the global history register of a squashed branch.
+         * @param history The history the branch was predicted with.
+         */
+        void
+        squash(unsigned tid, unsigned history)
+        {
+            globalHistoryReg[tid] = history;
+        }
+
+        /**
+         *  Returns the index of the predictor table given the value of the
+         *  program counter and global history.
+         *  @param branch_addr The address of the branch.
+         *  @param globalHistory Global history register's value.
+         *  @return The index of the predictor table.
+         */
+        unsigned
+        getIndex(uint64_t branch_addr, unsigned globalHistory) const
+        {
+            unsigned temp = (branch_addr >> instShiftAmt) & programCounterMask;  // Drop the bits that are always 0 in instruction addresses
+            return ((temp << globalHistoryBits) | globalHistory) & indexMask;   // Concatenate the branch address bits with the global history
+        }
+
+        /**
+         *  Returns the taken/not taken prediction given the value of the
+         *  counter.
+         *  @param count The value of the counter.
+         *  @return The prediction based on the counter value.
+         */
+        bool
+        getPrediction(uint8_t count) const
+        {
+            return count >> (CounterCtrBits - 1);               // Get the MSB of the count
+        }
+
+        /* Size of local Predictor */
+        const unsigned CounterPredictorSize;
+
+        /* Size of counter bits */
+        const unsigned CounterCtrBits;
+
+        /* Size of global Predictor */
+        const unsigned globalHistoryBits;
+
+        /* Low address bits dropped from branch addresses */
+        const unsigned instShiftAmt;
+
+        unsigned n;                                 // Branch address bits to be considered for indexing predictor table
+        unsigned programCounterMask;                // Mask to determine how many bits of branch_addr to consider.
+        unsigned historyRegisterMask;               // Mask to determine how many bits of globalHistoryReg to consider.
+        unsigned indexMask;                         // Mask to determine how many bits of concatenated index to consider.
+        PackedCounterTable counters;                // Packed table of saturating counters to store the predictions
+        std::vector<unsigned> globalHistoryReg;     // Global History Register
+
+    private:
+        /**
+         * Updates the global history register with parameter value taken.
+         * @param taken Whether or not the branch was taken.
+         */
+        void
+        updateGlobalHistReg(unsigned tid, bool taken)
+        {
+            globalHistoryReg[tid] =
+                ((globalHistoryReg[tid] << 1) | taken) & historyRegisterMask;
+        }
+
+        static unsigned
+        bitMask(unsigned bits)
+        {
+            return bits >= 32 ? ~0u : (1u << bits) - 1;
+        }
+};
+
+#endif // __CPU_PRED_GSELECT_CORE_HH__
@@ -0,0 +1,260 @@
+/**
+ * Standalone replay of GSelect branch traces over many predictor
+ * configurations at once.
+ *
+ * Record a trace by setting branchTrace on a GSelectBP, e.g.
+ *     system.cpu.branchPred.branchTrace = "branches.trace"
+ * and build the tool from the root of the gem5 tree:
+ *     g++ -O3 -std=c++14 -pthread -Isrc util/gselect_replay.cc \
+ *         -o gselect_replay
+ *
+ * Usage:
+ *     gselect_replay [-j threads] [-s sizes] [-c counter bits]
+ *                    [-g history bits] [-x] trace...
+ * Sizes and bits are comma separated lists, every combination of them is
+ * replayed against every trace. Results are printed as CSV, one line per
+ * trace and configuration, in the order they were requested.
+ *
+ * Traces are replayed with GSelectCore::replayBatch(). With -x every job is
+ * also replayed branch by branch through the calls the simulator makes, and
+ * the tool fails if the counts or the final predictor state differ.
+ *
+ * Each committed branch is predicted with the same GSelectCore code the
+ * simulator runs and trained right away, which is the predictor seeing an
+ * ideal pipeline: a mispredicted branch repairs the global history through
+ * the squash path and nothing younger is ever fetched down the wrong path.
+ * A taken prediction for a branch the BTB did not know when it was recorded
+ * is fetched as not taken and clears the newest history bit, like
+ * BPredUnit::predict() does, except for calls and returns.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cpu/pred/gselect_core.hh"
+#include "cpu/pred/gselect_trace.hh"
+
+namespace
+{
+
+struct Config
+{
+    unsigned size;
+    unsigned ctrBits;
+    unsigned historyBits;
+};
+
+typedef GSelectCore::BatchResult Result;
+
+std::vector<unsigned>
+parseList(const char *arg)
+{
+    std::vector<unsigned> values;
+    std::string list(arg);
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        values.push_back(std::stoul(list.substr(start, end - start)));
+        start = end + 1;
+    }
+    return values;
+}
+
+GSelectCore
+makeCore(const GSelectTrace::Reader &trace, const Config &config)
+{
+    return GSelectCore(config.size, config.ctrBits, config.historyBits,
+                       trace.header().instShiftAmt, 16);
+}
+
+/**
+ * Replays a trace one branch at a time through lookup(), btbUpdate() and
+ * update(), the reference replayBatch() is checked against.
+ */
+Result
+replayPerBranch(const GSelectTrace::Reader &trace, GSelectCore &core)
+{
+    Result result;
+    const uint64_t *records = trace.records();
+    for (size_t i = 0; i < trace.size(); i++) {
+        uint64_t record = records[i];
+        unsigned tid = GSelectTrace::tid(record);
+        uint64_t pc = GSelectTrace::pc(record);
+        bool taken = GSelectTrace::has(record, GSelectTrace::Taken);
+        bool uncond = GSelectTrace::has(record, GSelectTrace::Uncond);
+
+        unsigned history;
+        bool predicted;
+        if (uncond) {
+            core.uncondBranch(tid, history);
+            predicted = true;
+            result.uncondBranches++;
+        } else {
+            predicted = core.lookup(tid, pc, history);
+            result.condPredicted++;
+        }
+        if (predicted && GSelectTrace::has(record, GSelectTrace::BTBMiss) &&
+            !GSelectTrace::has(record, GSelectTrace::CallReturn)) {
+            core.btbUpdate(tid);
+            predicted = false;
+        }
+        if (predicted != taken) {
+            core.update(tid, pc, taken, history, true);
+            result.condIncorrect += !uncond;
+        }
+        core.update(tid, pc, taken, history, false);
+    }
+    return result;
+}
+
+/**
+ * @param check Also replay branch by branch and compare.
+ * @param mismatch Set when the two replays disagree.
+ */
+Result
+replay(const GSelectTrace::Reader &trace, const Config &config, bool check,
+       bool &mismatch)
+{
+    Result result;
+    GSelectCore core = makeCore(trace, config);
+    core.replayBatch(trace.records(), trace.size(), result);
+    mismatch = false;
+    if (check) {
+        GSelectCore reference = makeCore(trace, config);
+        Result expected = replayPerBranch(trace, reference);
+        mismatch = expected.condPredicted != result.condPredicted ||
+            expected.condIncorrect != result.condIncorrect ||
+            expected.uncondBranches != result.uncondBranches ||
+            reference.counters.saveWords() != core.counters.saveWords() ||
+            reference.globalHistoryReg != core.globalHistoryReg;
+    }
+    return result;
+}
+
+void
+usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-j threads] [-s sizes] [-c counter bits] "
+            "[-g history bits] [-x] trace...\n", name);
+    exit(1);
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char **argv)
+{
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> sizes = {1024, 4096, 8192};
+    std::vector<unsigned> ctrBits = {2};
+    std::vector<unsigned> historyBits = {6, 8};
+    std::vector<std::string> paths;
+    bool check = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg[0] != '-') {
+            paths.push_back(arg);
+            continue;
+        }
+        if (arg == "-x") {
+            check = true;
+            continue;
+        }
+        if (i + 1 == argc) {
+            usage(argv[0]);
+        }
+        if (arg == "-j") {
+            threads = std::max(1ul, std::stoul(argv[++i]));
+        } else if (arg == "-s") {
+            sizes = parseList(argv[++i]);
+        } else if (arg == "-c") {
+            ctrBits = parseList(argv[++i]);
+        } else if (arg == "-g") {
+            historyBits = parseList(argv[++i]);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (paths.empty()) {
+        usage(argv[0]);
+    }
+
+    std::vector<GSelectTrace::Reader> traces(paths.size());
+    for (size_t t = 0; t < paths.size(); t++) {
+        std::string error = traces[t].open(paths[t]);
+        if (!error.empty()) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+    }
+
+    std::vector<Config> configs;
+    for (unsigned size : sizes) {
+        for (unsigned bits : ctrBits) {
+            for (unsigned history : historyBits) {
+                if (!GSelectCore::validConfig(size, bits, history)) {
+                    fprintf(stderr, "skipping size=%u ctrBits=%u "
+                            "historyBits=%u\n", size, bits, history);
+                    continue;
+                }
+                configs.push_back(Config{size, bits, history});
+            }
+        }
+    }
+
+    // Every (trace, configuration) pair is an independent job, workers
+    // pull the next one until none is left.
+    size_t jobs = traces.size() * configs.size();
+    std::vector<Result> results(jobs);
+    std::vector<char> mismatches(jobs, false);
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < std::min<size_t>(threads, jobs); w++) {
+        workers.emplace_back([&]() {
+            for (size_t job = next++; job < jobs; job = next++) {
+                bool mismatch;
+                results[job] = replay(traces[job / configs.size()],
+                                      configs[job % configs.size()], check,
+                                      mismatch);
+                mismatches[job] = mismatch;
+            }
+        });
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    printf("trace,CounterPredictorSize,CounterCtrBits,globalHistoryBits,"
+           "condPredicted,condIncorrect,accuracy\n");
+    for (size_t job = 0; job < jobs; job++) {
+        const Config &config = configs[job % configs.size()];
+        const Result &result = results[job];
+        double accuracy = result.condPredicted ?
+            1.0 - double(result.condIncorrect) / result.condPredicted : 0.0;
+        printf("%s,%u,%u,%u,%lu,%lu,%.6f\n",
+               paths[job / configs.size()].c_str(), config.size,
+               config.ctrBits, config.historyBits,
+               (unsigned long)result.condPredicted,
+               (unsigned long)result.condIncorrect, accuracy);
+    }
+    int status = 0;
+    for (size_t job = 0; job < jobs; job++) {
+        if (mismatches[job]) {
+            const Config &config = configs[job % configs.size()];
+            fprintf(stderr, "%s,%u,%u,%u: batch and per-branch replays "
+                    "differ\n", paths[job / configs.size()].c_str(),
+                    config.size, config.ctrBits, config.historyBits);
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,241 @@
+#include "cpu/pred/gselect_tage.hh"
+
+namespace
+{
+
+/**
+ * History lengths of the tagged tables: the ones given, or a geometric
+ * series between the shortest and longest. The whole geometry is checked
+ * here, before the tables are allocated.
+ */
+std::vector<unsigned>
+historyLengthsOf(const GSelectTageBPParams *params)
+{
+    std::vector<unsigned> lengths = params->historyLengths;
+    if (lengths.empty()) {
+        fatal_if(params->numTaggedTables == 0, "GSelectTage needs at least one tagged table!\n");
+        fatal_if(params->minHistoryBits == 0 || params->maxHistoryBits < params->minHistoryBits,
+                 "Invalid GSelectTage history lengths %u to %u!\n",
+                 params->minHistoryBits, params->maxHistoryBits);
+        lengths = GSelectTageCore::geometricLengths(params->numTaggedTables,
+                                                    params->minHistoryBits,
+                                                    params->maxHistoryBits);
+    }
+    fatal_if(!GSelectTageCore::validConfig(params->CounterPredictorSize, params->CounterCtrBits,
+                                           params->globalHistoryBits, params->taggedTableSize,
+                                           params->tagBits, params->taggedCtrBits, lengths),
+             "Invalid GSelectTage table sizes, counter bits, tag bits or history lengths!\n");
+    return lengths;
+}
+
+GSelectTageCore::Checkpoint
+checkpointPrototype(const GSelectTageCore &core)
+{
+    GSelectTageCore::Checkpoint checkpoint;
+    core.initCheckpoint(checkpoint);
+    return checkpoint;
+}
+
+} // anonymous namespace
+
+GSelectTageBP::GSelectTageBP(const GSelectTageBPParams *params)
+    : BPredUnit(params),
+    core(params->CounterPredictorSize, params->CounterCtrBits,
+         params->globalHistoryBits, params->taggedTableSize, params->tagBits,
+         params->taggedCtrBits, historyLengthsOf(params), params->uResetPeriod,
+         params->instShiftAmt, params->numThreads,
+         HistoryRings<BPHistory>::slotsFor("GSelectTage", params->historyCheckpoints)),
+    historyRings("GSelectTage", params->numThreads, params->historyCheckpoints,
+                 checkpointPrototype(core)),
+    tageStats(*this, core.numTables)
+{
+    for (unsigned t = 0; t < core.numTables; t++) {
+        DPRINTF(GSelectTage, "Tagged table %u: %u history bits\n", t, core.historyLengths[t]);
+    }
+}
+
+bool GSelectTageBP::lookup(ThreadID tid, Addr branch_addr, void * &bp_history)
+{
+    BPHistory *history = historyRings.take(tid);                // Checkpoint the history for the case of squash
+    bp_history = static_cast<void*>(history);
+    bool taken = core.lookup(tid, branch_addr, *history);       // Predict and shift the prediction into the global history
+    DPRINTF(GSelectTage, "lookup %#x: provider %d alternate %d prediction %d\n",
+            branch_addr, history->provider, history->alternate, taken);
+    return taken;
+}
+
+void GSelectTageBP::btbUpdate(ThreadID tid, Addr branch_addr, void * &bp_history)
+{
+    DPRINTF(GSelectTage, "btbUpdate\n");
+    core.btbUpdate(tid, *static_cast<BPHistory*>(bp_history));   // Replace the newest history bit with not taken
+}
+
+void GSelectTageBP::update(ThreadID tid, Addr branch_addr, bool taken, void *bp_history,
+                           bool squashed, const StaticInstPtr & inst, Addr corrTarget)
+{
+    assert(bp_history);
+
+    BPHistory *history = static_cast<BPHistory*>(bp_history);  // Checkpoint taken when the branch was predicted
+    // On a squash only the global history is repaired, like GSelectBP the
+    // tables are trained at commit with the indices of the prediction
+    unsigned allocated = core.update(tid, branch_addr, taken, *history, squashed);
+    if (squashed) {
+        DPRINTF(GSelectTage, "squashed %#x\n", branch_addr);
+        return;
+    }
+
+    if (history->conditional) {
+        unsigned provider = history->provider + 1;              // 0 is the base
+        tageStats.providers[provider]++;
+        if (history->taken != taken) {
+            tageStats.providerMispredicts[provider]++;
+        }
+        tageStats.allocations += allocated;
+    }
+    historyRings.commit(tid, history);
+}
+
+void GSelectTageBP::squash(ThreadID tid, void *bp_history)
+{
+    if(bp_history==NULL)
+    {
+        return;
+    }
+    BPHistory *history = static_cast<BPHistory*>(bp_history);
+    core.squash(tid, *history);                                 // Restore the history recorded before the prediction
+    historyRings.squash(tid, history);
+}
+
+void GSelectTageBP::uncondBranch(ThreadID tid, Addr pc, void * &bp_history)
+{
+    BPHistory *history = historyRings.take(tid);
+    bp_history = static_cast<void*>(history);
+    core.uncondBranch(tid, *history);                           // Shift taken into the global history
+}
+
+void GSelectTageBP::serialize(CheckpointOut &cp) const
+{
+    historyRings.checkDrained();
+    /* Geometry the tables were checkpointed with, checked on restore */
+    unsigned CounterPredictorSize = core.base.CounterPredictorSize;
+    unsigned taggedTableSize = core.tables.empty() ? 0 : core.tables[0].size();
+    unsigned tagBits = core.tagBits;
+    const std::vector<unsigned> &historyLengths = core.historyLengths;
+    SERIALIZE_SCALAR(CounterPredictorSize);
+    SERIALIZE_SCALAR(taggedTableSize);
+    SERIALIZE_SCALAR(tagBits);
+    SERIALIZE_CONTAINER(historyLengths);
+
+    std::vector<uint64_t> baseCounters = core.base.counters.saveWords();
+    SERIALIZE_CONTAINER(baseCounters);
+    const std::vector<unsigned> &baseHistory = core.base.globalHistoryReg;
+    SERIALIZE_CONTAINER(baseHistory);
+
+    /* Tagged entries one word each: tag, counter and usefulness */
+    std::vector<uint32_t> entries;
+    for (const std::vector<GSelectTageCore::Entry> &table : core.tables) {
+        for (const GSelectTageCore::Entry &entry : table) {
+            entries.push_back(uint32_t(entry.tag) << 16 | entry.ctr << 8 | entry.u);
+        }
+    }
+    SERIALIZE_CONTAINER(entries);
+    unsigned useAltOnNewlyAllocated = core.useAltOnNewlyAllocated;
+    unsigned updatesSinceReset = core.updatesSinceReset;
+    SERIALIZE_SCALAR(useAltOnNewlyAllocated);
+    SERIALIZE_SCALAR(updatesSinceReset);
+
+    /* Global histories of all threads, back to back */
+    std::vector<unsigned> historyBits, positions, folded;
+    for (const GSelectTageCore::Thread &thread : core.threads) {
+        historyBits.insert(historyBits.end(), thread.buffer.begin(), thread.buffer.end());
+        positions.push_back(thread.position);
+        folded.insert(folded.end(), thread.folded.begin(), thread.folded.end());
+    }
+    SERIALIZE_CONTAINER(historyBits);
+    SERIALIZE_CONTAINER(positions);
+    SERIALIZE_CONTAINER(folded);
+}
+
+void GSelectTageBP::unserialize(CheckpointIn &cp)
+{
+    unsigned CounterPredictorSize, taggedTableSize, tagBits;
+    std::vector<unsigned> historyLengths;
+    UNSERIALIZE_SCALAR(CounterPredictorSize);
+    UNSERIALIZE_SCALAR(taggedTableSize);
+    UNSERIALIZE_SCALAR(tagBits);
+    UNSERIALIZE_CONTAINER(historyLengths);
+    fatal_if(CounterPredictorSize != core.base.CounterPredictorSize ||
+             taggedTableSize != core.tables[0].size() || tagBits != core.tagBits ||
+             historyLengths != core.historyLengths,
+             "GSelectTage checkpoint was taken with a different geometry\n");
+
+    std::vector<uint64_t> baseCounters;
+    UNSERIALIZE_CONTAINER(baseCounters);
+    fatal_if(!core.base.counters.restoreWords(baseCounters),
+             "GSelectTage checkpoint base counter table is corrupt\n");
+    std::vector<unsigned> baseHistory;
+    UNSERIALIZE_CONTAINER(baseHistory);
+    fatal_if(baseHistory.size() != core.threads.size(),
+             "GSelectTage checkpoint has %u threads, the predictor %u\n",
+             baseHistory.size(), core.threads.size());
+    core.base.globalHistoryReg = baseHistory;
+
+    std::vector<uint32_t> entries;
+    UNSERIALIZE_CONTAINER(entries);
+    fatal_if(entries.size() != core.numTables * taggedTableSize,
+             "GSelectTage checkpoint tagged tables are corrupt\n");
+    auto entry = entries.begin();
+    for (std::vector<GSelectTageCore::Entry> &table : core.tables) {
+        for (GSelectTageCore::Entry &e : table) {
+            e.tag = *entry >> 16;
+            e.ctr = (*entry >> 8) & 0xFF;
+            e.u = *entry & 0xFF;
+            ++entry;
+        }
+    }
+    unsigned useAltOnNewlyAllocated, updatesSinceReset;
+    UNSERIALIZE_SCALAR(useAltOnNewlyAllocated);
+    UNSERIALIZE_SCALAR(updatesSinceReset);
+    core.useAltOnNewlyAllocated = useAltOnNewlyAllocated;
+    core.updatesSinceReset = updatesSinceReset;
+
+    std::vector<unsigned> historyBits, positions, folded;
+    UNSERIALIZE_CONTAINER(historyBits);
+    UNSERIALIZE_CONTAINER(positions);
+    UNSERIALIZE_CONTAINER(folded);
+    size_t bufferSize = core.threads[0].buffer.size();
+    size_t foldedSize = core.threads[0].folded.size();
+    fatal_if(historyBits.size() != bufferSize * core.threads.size() ||
+             positions.size() != core.threads.size() ||
+             folded.size() != foldedSize * core.threads.size(),
+             "GSelectTage checkpoint global histories are corrupt\n");
+    for (size_t t = 0; t < core.threads.size(); t++) {
+        GSelectTageCore::Thread &thread = core.threads[t];
+        thread.buffer.assign(historyBits.begin() + t * bufferSize,
+                             historyBits.begin() + (t + 1) * bufferSize);
+        thread.position = positions[t];
+        thread.folded.assign(folded.begin() + t * foldedSize,
+                             folded.begin() + (t + 1) * foldedSize);
+    }
+}
+
+GSelectTageBP::GSelectTageStats::GSelectTageStats(GSelectTageBP &parent, unsigned numTables)
+    : Stats::Group(&parent, "tage"),
+      ADD_STAT(providers, "Number of committed conditional branches predicted by the base and each tagged table"),
+      ADD_STAT(providerMispredicts, "Number of those branches that were mispredicted"),
+      ADD_STAT(allocations, "Number of tagged entries allocated on mispredictions")
+{
+    providers.init(numTables + 1).flags(Stats::total | Stats::pdf);
+    providerMispredicts.init(numTables + 1).flags(Stats::total);
+    providers.subname(0, "base");
+    providerMispredicts.subname(0, "base");
+    for (unsigned t = 0; t < numTables; t++) {
+        providers.subname(t + 1, "tagged" + std::to_string(t));
+        providerMispredicts.subname(t + 1, "tagged" + std::to_string(t));
+    }
+}
+
+GSelectTageBP* GSelectTageBPParams::create()
+{
+    return new GSelectTageBP(this);
+}
@@ -0,0 +1,95 @@
+#ifndef __CPU_PRED_GSELECT_TAGE_HH__
+#define __CPU_PRED_GSELECT_TAGE_HH__
+
+#include <vector>
+
+#include "base/statistics.hh"
+#include "base/types.hh"
+#include "cpu/pred/bpred_unit.hh"
+#include "cpu/pred/gselect_tage_core.hh"
+#include "cpu/pred/history_ring.hh"
+#include "params/GSelectTageBP.hh"
+#include "sim/serialize.hh"
+#include "debug/GSelectTage.hh"
+
+/**
+ * TAGE-style predictor with a GSelect base: the base table predicts the
+ * branches no tagged table has learnt, tagged tables indexed with
+ * geometrically longer global history override it. History checkpoints
+ * and squash recovery work like in GSelectBP.
+ */
+class GSelectTageBP : public BPredUnit
+{
+    public:
+        GSelectTageBP(const GSelectTageBPParams *params);
+
+        /**
+         * Restores the global history recorded before the prediction.
+         * @param bp_history The checkpoint of the squashed branch.
+         */
+        void squash(ThreadID tid, void *bp_history);
+
+        /**
+         * Updates the predictor with the actual result of a branch.
+         * @param branch_addr The address of the branch to update.
+         * @param taken Whether or not the branch was taken.
+         * @param bp_history The checkpoint of the branch.
+         * @param squashed Whether any outstanding updates are squashed or not.
+         */
+        void update(ThreadID tid, Addr branch_addr, bool taken, void *bp_history,
+                    bool squashed, const StaticInstPtr & inst, Addr corrTarget);
+
+        /**
+         * Shifts an unconditional branch into the global history as taken.
+         * @param bp_history Set to the checkpoint of the branch.
+         */
+        void uncondBranch(ThreadID tid, Addr pc, void * &bp_history);
+
+        /**
+         * Turns the newest history bit into not taken if a BTB entry is
+         * invalid or not found.
+         * @param bp_history The checkpoint of the branch.
+         */
+        void btbUpdate(ThreadID tid, Addr branch_addr, void * &bp_history);
+
+        /**
+         * Looks up the given address in the tagged tables and the base.
+         * @param branch_addr The address of the branch to look up.
+         * @param bp_history Set to the checkpoint of the branch.
+         * @return Whether or not the branch is taken.
+         */
+        bool lookup(ThreadID tid, Addr branch_addr, void * &bp_history);
+
+        /**
+         * Checkpoints the tables and the global histories. Only taken while
+         * drained, with no branch in flight.
+         */
+        void serialize(CheckpointOut &cp) const override;
+
+        /**
+         * Restores the tables and the global histories of a predictor with
+         * the same geometry.
+         */
+        void unserialize(CheckpointIn &cp) override;
+
+    private:
+        typedef GSelectTageCore::Checkpoint BPHistory;
+
+        struct GSelectTageStats : public Stats::Group
+        {
+            GSelectTageStats(GSelectTageBP &parent, unsigned numTables);
+
+            /** Committed conditional branches predicted by the base and by each tagged table */
+            Stats::Vector providers;
+            /** Mispredicted conditional branches per provider */
+            Stats::Vector providerMispredicts;
+            /** Tagged entries allocated on mispredictions */
+            Stats::Scalar allocations;
+        };
+
+        GSelectTageCore core;                       // Base GSelect, tagged tables and global histories
+        HistoryRings<BPHistory> historyRings;       // Per-thread in-flight history checkpoints
+        GSelectTageStats tageStats;
+};
+
+#endif // __CPU_PRED_GSELECT_TAGE_HH__
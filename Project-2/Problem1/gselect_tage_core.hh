@@ -0,0 +1,509 @@
+#ifndef __CPU_PRED_GSELECT_TAGE_CORE_HH__
+#define __CPU_PRED_GSELECT_TAGE_CORE_HH__
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "cpu/pred/gselect_core.hh"
+
+/**
+ * State and prediction logic of GSelectTage, a TAGE-style predictor built
+ * on GSelect: a GSelectCore is the base predictor, by default indexed with
+ * the branch address only, and a set of partially tagged tables sits on
+ * top of it. Each tagged table is indexed and tagged with a hash of the
+ * branch address and a longer slice of global history, the lengths growing
+ * geometrically from table to table. The longest table with a matching tag
+ * provides the prediction, the next one or the base is the alternate.
+ *
+ * Global history is a per-thread circular buffer of bits with the hashes of
+ * each table's slice kept folded down incrementally, so a branch is indexed
+ * in time independent of the history lengths. A checkpoint holds the
+ * buffer position and the folded hashes, which is all a squash has to
+ * restore: the bits younger than a checkpoint are never overwritten while
+ * it is in flight since the buffer holds the longest history plus every
+ * in-flight branch.
+ *
+ * Like GSelectCore it has no dependency on the rest of gem5, and it leaves
+ * keeping the checkpoints of in-flight branches to the caller.
+ */
+class GSelectTageCore
+{
+    public:
+        /**
+         * History a branch was predicted with and where its prediction came
+         * from, enough to repair the history and train the tables later.
+         */
+        struct Checkpoint
+        {
+            unsigned baseHistory;           // Global history register of the base GSelect
+            unsigned position;              // Buffer position of the newest history bit
+            std::vector<uint32_t> folded;   // Folded history hashes, three per tagged table
+            std::vector<uint32_t> indices;  // Index looked up in each tagged table
+            std::vector<uint16_t> tags;     // Tag looked up in each tagged table
+            int provider;                   // Tagged table that provided the prediction, -1 for the base
+            int alternate;                  // Tagged table that provided the alternate, -1 for the base
+            bool providerTaken;             // Prediction of the provider
+            bool alternateTaken;            // Prediction of the alternate
+            bool taken;                     // Final prediction
+            bool conditional;               // False for unconditional branches, which train nothing
+        };
+
+        /**
+         * @param baseSize Counters of the base GSelect, a power of 2.
+         * @param baseCtrBits Bits per base counter.
+         * @param baseHistoryBits Global history bits in the base index, 0
+         * for a bimodal base.
+         * @param taggedTableSize Entries per tagged table, a power of 2 of at
+         * least 2.
+         * @param tagBits Bits per tag, 2 to 16.
+         * @param ctrBits Bits per tagged counter, 2 to 8.
+         * @param historyLengths History bits hashed into each tagged table,
+         * increasing.
+         * @param uResetPeriod Tagged updates between halvings of the
+         * usefulness counters.
+         * @param instShiftAmt Low branch address bits that are always 0.
+         * @param numThreads Number of global histories.
+         * @param maxInFlight Checkpoints a thread can have in flight.
+         */
+        GSelectTageCore(unsigned baseSize, unsigned baseCtrBits,
+                        unsigned baseHistoryBits, unsigned taggedTableSize,
+                        unsigned tagBits, unsigned ctrBits,
+                        const std::vector<unsigned> &historyLengths,
+                        unsigned uResetPeriod, unsigned instShiftAmt,
+                        unsigned numThreads, unsigned maxInFlight)
+            : base(baseSize, baseCtrBits, baseHistoryBits, instShiftAmt,
+                   numThreads),
+              numTables(historyLengths.size()),
+              historyLengths(historyLengths),
+              tableBits(log2(taggedTableSize)),
+              tagBits(tagBits),
+              ctrMax((1u << ctrBits) - 1),
+              uResetPeriod(uResetPeriod),
+              instShiftAmt(instShiftAmt),
+              tables(numTables, std::vector<Entry>(taggedTableSize, Entry())),
+              useAltOnNewlyAllocated(useAltMax / 2 + 1),
+              updatesSinceReset(0),
+              random(0x2545F491)
+        {
+            unsigned longest = historyLengths.empty() ? 0 : historyLengths.back();
+            bufferMask = (1u << log2(longest + maxInFlight + 1)) - 1;
+            for (unsigned length : historyLengths) {
+                foldedLength.push_back(tableBits);      // Index hash
+                foldedLength.push_back(tagBits);        // Two tag hashes of different widths,
+                foldedLength.push_back(tagBits - 1);    // so a slice and its shift hash apart
+                for (unsigned i = 0; i < 3; i++) {
+                    foldedOrigin.push_back(length);
+                }
+            }
+            threads.assign(numThreads, Thread());
+            for (Thread &thread : threads) {
+                thread.buffer.assign(bufferMask + 1, 0);
+                thread.position = 0;
+                thread.folded.assign(3 * numTables, 0);
+            }
+        }
+
+        /**
+         * @return Whether the parameters describe a usable predictor.
+         */
+        static bool
+        validConfig(unsigned baseSize, unsigned baseCtrBits,
+                    unsigned baseHistoryBits, unsigned taggedTableSize,
+                    unsigned tagBits, unsigned ctrBits,
+                    const std::vector<unsigned> &historyLengths)
+        {
+            bool powerOf2 = taggedTableSize >= 2 &&
+                !(taggedTableSize & (taggedTableSize - 1));
+            bool increasing = !historyLengths.empty() && historyLengths[0] > 0;
+            for (size_t i = 1; i < historyLengths.size(); i++) {
+                increasing = increasing && historyLengths[i] > historyLengths[i - 1];
+            }
+            return GSelectCore::validConfig(baseSize, baseCtrBits, baseHistoryBits) &&
+                powerOf2 && taggedTableSize <= (1u << 24) &&
+                tagBits >= 2 && tagBits <= 16 && ctrBits >= 2 && ctrBits <= 8 &&
+                increasing && historyLengths.back() <= 4096;
+        }
+
+        /**
+         * @return History lengths growing geometrically from shortest to
+         * longest over the given number of tables.
+         */
+        static std::vector<unsigned>
+        geometricLengths(unsigned numTables, unsigned shortest, unsigned longest)
+        {
+            std::vector<unsigned> lengths;
+            for (unsigned i = 0; i < numTables; i++) {
+                double ratio = numTables > 1 ? double(i) / (numTables - 1) : 0.0;
+                unsigned length = unsigned(shortest *
+                    std::pow(double(longest) / shortest, ratio) + 0.5);
+                if (!lengths.empty() && length <= lengths.back()) {
+                    length = lengths.back() + 1;        // Rounding must not repeat a length
+                }
+                lengths.push_back(length);
+            }
+            return lengths;
+        }
+
+        /**
+         * Sizes the vectors of a checkpoint for this predictor, done once
+         * for every slot so taking a checkpoint never allocates.
+         */
+        void
+        initCheckpoint(Checkpoint &checkpoint) const
+        {
+            checkpoint.folded.assign(3 * numTables, 0);
+            checkpoint.indices.assign(numTables, 0);
+            checkpoint.tags.assign(numTables, 0);
+        }
+
+        /**
+         * Predicts a conditional branch and shifts the prediction into the
+         * thread's global history.
+         * @param checkpoint Filled with the history the branch is predicted
+         * with and the tables that predicted it.
+         * @return Whether or not the branch is predicted taken.
+         */
+        bool
+        lookup(unsigned tid, uint64_t branch_addr, Checkpoint &checkpoint)
+        {
+            save(tid, checkpoint);
+            checkpoint.conditional = true;
+            checkpoint.provider = checkpoint.alternate = -1;
+            uint64_t pc = branch_addr >> instShiftAmt;
+            const Thread &thread = threads[tid];
+            for (unsigned t = 0; t < numTables; t++) {
+                checkpoint.indices[t] = index(t, pc, thread.folded);
+                checkpoint.tags[t] = tag(t, pc, thread.folded);
+            }
+            for (int t = numTables - 1; t >= 0; t--) {
+                if (tables[t][checkpoint.indices[t]].tag == checkpoint.tags[t]) {
+                    if (checkpoint.provider < 0) {
+                        checkpoint.provider = t;
+                    } else {
+                        checkpoint.alternate = t;
+                        break;
+                    }
+                }
+            }
+
+            bool baseTaken = base.lookup(tid, branch_addr, checkpoint.baseHistory);
+            checkpoint.alternateTaken = checkpoint.alternate < 0 ? baseTaken :
+                isTaken(entryOf(checkpoint, checkpoint.alternate).ctr);
+            if (checkpoint.provider < 0) {
+                checkpoint.providerTaken = checkpoint.taken = baseTaken;
+            } else {
+                const Entry &entry = entryOf(checkpoint, checkpoint.provider);
+                checkpoint.providerTaken = isTaken(entry.ctr);
+                // A newly allocated entry has not seen enough to beat the
+                // alternate on average, the global counter tracks whether it does
+                checkpoint.taken = isNewlyAllocated(entry) &&
+                    useAltOnNewlyAllocated > useAltMax / 2 ?
+                    checkpoint.alternateTaken : checkpoint.providerTaken;
+            }
+            if (checkpoint.taken != baseTaken) {
+                // The base history holds the final prediction, not its own
+                base.update(tid, branch_addr, checkpoint.taken,
+                            checkpoint.baseHistory, true);
+            }
+            push(tid, checkpoint.taken);
+            return checkpoint.taken;
+        }
+
+        /**
+         * Shifts an unconditional, always taken branch into the thread's
+         * global history.
+         * @param checkpoint Filled with the history before the branch.
+         */
+        void
+        uncondBranch(unsigned tid, Checkpoint &checkpoint)
+        {
+            save(tid, checkpoint);
+            checkpoint.conditional = false;
+            checkpoint.provider = checkpoint.alternate = -1;
+            checkpoint.providerTaken = checkpoint.alternateTaken = true;
+            checkpoint.taken = true;
+            base.uncondBranch(tid, checkpoint.baseHistory);
+            push(tid, true);
+        }
+
+        /**
+         * Turns the newest history bit into not taken, used when the BTB has
+         * no target for a branch predicted taken.
+         * @param checkpoint The checkpoint of that branch.
+         */
+        void
+        btbUpdate(unsigned tid, const Checkpoint &checkpoint)
+        {
+            base.btbUpdate(tid);
+            restore(tid, checkpoint);
+            push(tid, false);
+        }
+
+        /**
+         * Updates the predictor with the actual outcome of a branch.
+         * @param checkpoint The checkpoint the branch was predicted with.
+         * @param squashed True when the branch was mispredicted and the
+         * younger branches are being squashed: only the history is
+         * repaired, the tables are trained at commit.
+         * @return Number of tagged entries allocated.
+         */
+        unsigned
+        update(unsigned tid, uint64_t branch_addr, bool taken,
+               const Checkpoint &checkpoint, bool squashed)
+        {
+            if (squashed) {
+                base.update(tid, branch_addr, taken, checkpoint.baseHistory, true);
+                restore(tid, checkpoint);
+                push(tid, taken);
+                return 0;
+            }
+            if (!checkpoint.conditional) {
+                return 0;
+            }
+
+            int provider = checkpoint.provider;
+            Entry *entry = nullptr;
+            if (provider >= 0) {
+                entry = &entryOf(checkpoint, provider);
+                if (entry->tag != checkpoint.tags[provider]) {
+                    entry = nullptr;                    // Replaced since the lookup
+                }
+            }
+
+            if (entry && isNewlyAllocated(*entry) &&
+                checkpoint.providerTaken != checkpoint.alternateTaken) {
+                if (checkpoint.alternateTaken == taken) {
+                    useAltOnNewlyAllocated += useAltOnNewlyAllocated < useAltMax;
+                } else {
+                    useAltOnNewlyAllocated -= useAltOnNewlyAllocated > 0;
+                }
+            }
+
+            // Mispredicted, give the branch an entry in a longer history table
+            unsigned allocated = 0;
+            if (checkpoint.taken != taken && provider + 1 < int(numTables)) {
+                allocated = allocate(checkpoint, provider + 1, taken);
+            }
+
+            if (entry) {
+                // The alternate learns too while the provider is not useful yet
+                if (entry->u == 0) {
+                    trainAlternate(tid, branch_addr, taken, checkpoint);
+                }
+                entry->ctr = step(entry->ctr, taken);
+                if (checkpoint.providerTaken != checkpoint.alternateTaken) {
+                    if (checkpoint.providerTaken == taken) {
+                        entry->u += entry->u < uMax;
+                    } else {
+                        entry->u -= entry->u > 0;
+                    }
+                }
+            } else {
+                base.update(tid, branch_addr, taken, checkpoint.baseHistory, false);
+            }
+
+            if (uResetPeriod && ++updatesSinceReset >= uResetPeriod) {
+                // Age the usefulness so stale entries can be replaced again
+                updatesSinceReset = 0;
+                for (std::vector<Entry> &table : tables) {
+                    for (Entry &e : table) {
+                        e.u >>= 1;
+                    }
+                }
+            }
+            return allocated;
+        }
+
+        /**
+         * Restores the global history of a squashed branch.
+         * @param checkpoint The checkpoint the branch was predicted with.
+         */
+        void
+        squash(unsigned tid, const Checkpoint &checkpoint)
+        {
+            base.squash(tid, checkpoint.baseHistory);
+            restore(tid, checkpoint);
+        }
+
+        /**
+         * Entry of a tagged table: a partial tag, a prediction counter and
+         * a usefulness counter.
+         */
+        struct Entry
+        {
+            uint16_t tag = 0;
+            uint8_t ctr = 0;
+            uint8_t u = 0;
+        };
+
+        /**
+         * Global history of one thread.
+         */
+        struct Thread
+        {
+            std::vector<uint8_t> buffer;    // History bits, newest at position
+            unsigned position;              // Slot of the newest bit, moves down
+            std::vector<uint32_t> folded;   // Folded hashes of each table's slice
+        };
+
+        GSelectCore base;                           // Base predictor, trained when no tagged table hits
+        const unsigned numTables;
+        const std::vector<unsigned> historyLengths; // History bits of each tagged table
+        const unsigned tableBits;                   // log2 of the entries per tagged table
+        const unsigned tagBits;
+        const uint8_t ctrMax;                       // Value the tagged counters saturate at
+        const unsigned uResetPeriod;
+        const unsigned instShiftAmt;
+        std::vector<std::vector<Entry>> tables;     // Tagged tables, shortest history first
+        unsigned useAltOnNewlyAllocated;            // Whether newly allocated providers lose to the alternate
+        unsigned updatesSinceReset;                 // Tagged updates since the usefulness was aged
+        uint32_t random;                            // Allocation randomization state
+        std::vector<Thread> threads;
+
+        static const unsigned useAltMax = 15;
+        static const uint8_t uMax = 3;
+
+    private:
+        static unsigned
+        log2(unsigned value)
+        {
+            unsigned bits = 0;
+            while ((1u << bits) < value) {
+                bits++;
+            }
+            return bits;
+        }
+
+        bool isTaken(uint8_t ctr) const { return ctr > ctrMax / 2; }
+
+        /**
+         * A counter that is still weak and has never been useful.
+         */
+        bool
+        isNewlyAllocated(const Entry &entry) const
+        {
+            return entry.u == 0 &&
+                (entry.ctr == ctrMax / 2 || entry.ctr == ctrMax / 2 + 1);
+        }
+
+        uint8_t
+        step(uint8_t ctr, bool taken) const
+        {
+            return taken ? ctr + (ctr < ctrMax) : ctr - (ctr > 0);
+        }
+
+        Entry &
+        entryOf(const Checkpoint &checkpoint, int table)
+        {
+            return tables[table][checkpoint.indices[table]];
+        }
+
+        uint32_t
+        index(unsigned table, uint64_t pc, const std::vector<uint32_t> &folded) const
+        {
+            unsigned shift = (tableBits > table ? tableBits - table : table - tableBits) + 1;
+            return (pc ^ (pc >> shift) ^ folded[3 * table]) & ((1u << tableBits) - 1);
+        }
+
+        uint16_t
+        tag(unsigned table, uint64_t pc, const std::vector<uint32_t> &folded) const
+        {
+            return (pc ^ folded[3 * table + 1] ^ (folded[3 * table + 2] << 1)) &
+                ((1u << tagBits) - 1);
+        }
+
+        void
+        trainAlternate(unsigned tid, uint64_t branch_addr, bool taken,
+                       const Checkpoint &checkpoint)
+        {
+            if (checkpoint.alternate < 0) {
+                base.update(tid, branch_addr, taken, checkpoint.baseHistory, false);
+                return;
+            }
+            Entry &alternate = entryOf(checkpoint, checkpoint.alternate);
+            if (alternate.tag == checkpoint.tags[checkpoint.alternate]) {
+                alternate.ctr = step(alternate.ctr, taken);
+            }
+        }
+
+        /**
+         * Allocates one entry with no usefulness in the tables from first
+         * on, skipping the first candidate half of the time so branches do
+         * not all pile into the same table. When every candidate is useful
+         * their usefulness decays instead.
+         * @return Number of entries allocated.
+         */
+        unsigned
+        allocate(const Checkpoint &checkpoint, unsigned first, bool taken)
+        {
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            bool skip = random & 1;
+            int chosen = -1;
+            for (unsigned t = first; t < numTables; t++) {
+                if (entryOf(checkpoint, t).u == 0) {
+                    chosen = t;
+                    if (!skip) {
+                        break;
+                    }
+                    skip = false;
+                }
+            }
+            if (chosen < 0) {
+                for (unsigned t = first; t < numTables; t++) {
+                    Entry &entry = entryOf(checkpoint, t);
+                    entry.u -= entry.u > 0;
+                }
+                return 0;
+            }
+            Entry &entry = entryOf(checkpoint, chosen);
+            entry.tag = checkpoint.tags[chosen];
+            entry.ctr = taken ? ctrMax / 2 + 1 : ctrMax / 2;  // Weakly in the direction of the outcome
+            entry.u = 0;
+            return 1;
+        }
+
+        void
+        save(unsigned tid, Checkpoint &checkpoint) const
+        {
+            checkpoint.position = threads[tid].position;
+            checkpoint.folded = threads[tid].folded;    // Same size, no allocation
+        }
+
+        void
+        restore(unsigned tid, const Checkpoint &checkpoint)
+        {
+            threads[tid].position = checkpoint.position;
+            threads[tid].folded = checkpoint.folded;
+        }
+
+        /**
+         * Shifts a bit into the thread's history and each folded hash: the
+         * new bit enters at the bottom, the bit falling out of the table's
+         * slice leaves at the length modulo the hash width, and the bit
+         * shifted out at the top wraps around.
+         */
+        void
+        push(unsigned tid, bool taken)
+        {
+            Thread &thread = threads[tid];
+            thread.position = (thread.position - 1) & bufferMask;
+            thread.buffer[thread.position] = taken;
+            for (unsigned f = 0; f < thread.folded.size(); f++) {
+                unsigned length = foldedLength[f];
+                uint32_t value = (thread.folded[f] << 1) | taken;
+                value ^= uint32_t(thread.buffer[(thread.position + foldedOrigin[f]) & bufferMask])
+                    << (foldedOrigin[f] % length);
+                value ^= value >> length;
+                thread.folded[f] = value & ((1u << length) - 1);
+            }
+        }
+
+        unsigned bufferMask;                        // History buffer slots minus 1
+        std::vector<unsigned> foldedLength;         // Width of each folded hash
+        std::vector<unsigned> foldedOrigin;         // History bits folded into each hash
+};
+
+#endif // __CPU_PRED_GSELECT_TAGE_CORE_HH__
@@ -0,0 +1,161 @@
+#ifndef __CPU_PRED_GSELECT_TRACE_HH__
+#define __CPU_PRED_GSELECT_TRACE_HH__
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Binary trace of the committed branch stream seen by a branch predictor.
+ * The file is a 16-byte header followed by one 64-bit record per committed
+ * branch, in commit order. The number of records follows from the file size,
+ * so a trace is usable even if the simulator never closed it cleanly.
+ *
+ * A record holds, from the least significant bit up: the flags below, the
+ * thread id in bits 4-7 and the branch address in bits 8-63.
+ */
+namespace GSelectTrace
+{
+
+const char magic[8] = {'G', 'S', 'E', 'L', 'T', 'R', 'C', '1'};
+
+struct Header
+{
+    char magic[8];
+    uint32_t instShiftAmt;      // instShiftAmt of the recording predictor
+    uint32_t reserved;
+};
+
+const uint64_t Taken = 1;               // The branch was taken
+const uint64_t Uncond = 2;              // Unconditional branch, predicted through uncondBranch()
+const uint64_t BTBMiss = 4;             // The BTB had no entry for the branch when it was predicted
+const uint64_t CallReturn = 8;          // Calls and returns never clear history on a BTB miss
+
+inline uint64_t
+encode(uint64_t pc, unsigned tid, uint64_t flags)
+{
+    return (pc << 8) | ((tid & 0xF) << 4) | (flags & 0xF);
+}
+
+inline uint64_t pc(uint64_t record) { return record >> 8; }
+inline unsigned tid(uint64_t record) { return (record >> 4) & 0xF; }
+inline bool has(uint64_t record, uint64_t flag) { return record & flag; }
+
+/**
+ * Appends records to a trace file through stdio buffering.
+ */
+class Writer
+{
+    public:
+        Writer() : file(nullptr) {}
+        Writer(const Writer &) = delete;
+        Writer &operator=(const Writer &) = delete;
+        ~Writer() { close(); }
+
+        /**
+         * Creates the trace file and writes its header.
+         * @return False if the file could not be created.
+         */
+        bool
+        open(const std::string &path, unsigned instShiftAmt)
+        {
+            file = fopen(path.c_str(), "wb");
+            if (!file) {
+                return false;
+            }
+            setvbuf(file, nullptr, _IOFBF, 1 << 20);
+            Header header;
+            memcpy(header.magic, magic, sizeof(magic));
+            header.instShiftAmt = instShiftAmt;
+            header.reserved = 0;
+            fwrite(&header, sizeof(header), 1, file);
+            return true;
+        }
+
+        bool isOpen() const { return file; }
+
+        void
+        append(uint64_t record)
+        {
+            fwrite(&record, sizeof(record), 1, file);
+        }
+
+        void
+        close()
+        {
+            if (file) {
+                fclose(file);
+                file = nullptr;
+            }
+        }
+
+    private:
+        FILE *file;
+};
+
+/**
+ * Read-only view of a whole trace file, mapped into memory.
+ */
+class Reader
+{
+    public:
+        Reader() : base(nullptr), length(0) {}
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+        ~Reader() { if (base) munmap(base, length); }
+
+        /**
+         * Maps a trace file and checks its header.
+         * @return An error message, empty on success.
+         */
+        std::string
+        open(const std::string &path)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                return path + ": cannot open";
+            }
+            struct stat st;
+            fstat(fd, &st);
+            length = st.st_size;
+            if (length < sizeof(Header)) {
+                ::close(fd);
+                return path + ": too short for a branch trace";
+            }
+            base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (base == MAP_FAILED) {
+                base = nullptr;
+                return path + ": cannot map";
+            }
+            if (memcmp(header().magic, magic, sizeof(magic))) {
+                return path + ": not a GSelect branch trace";
+            }
+            return "";
+        }
+
+        const Header &header() const { return *static_cast<const Header *>(base); }
+
+        const uint64_t *
+        records() const
+        {
+            return reinterpret_cast<const uint64_t *>(
+                static_cast<const char *>(base) + sizeof(Header));
+        }
+
+        size_t size() const { return (length - sizeof(Header)) / sizeof(uint64_t); }
+
+    private:
+        void *base;
+        size_t length;
+};
+
+} // namespace GSelectTrace
+
+#endif // __CPU_PRED_GSELECT_TRACE_HH__
@@ -0,0 +1,175 @@
+#ifndef __CPU_PRED_HISTORY_RING_HH__
+#define __CPU_PRED_HISTORY_RING_HH__
+
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "base/logging.hh"
+#include "base/types.hh"
+
+/**
+ * Fixed-capacity ring of the in-flight history checkpoints of one thread.
+ * BPredUnit hands out predictions in program order, commits them oldest
+ * first and squashes them youngest first, so checkpoints are taken at the
+ * tail, released by update() at the head and released by squash() at the
+ * tail. The slots are allocated once and reused, so a checkpoint holding
+ * vectors keeps their storage from one branch to the next.
+ */
+template <class T>
+class HistoryRing
+{
+    public:
+        /**
+         * @param capacity Checkpoints that can be in flight, rounded up to a
+         * power of 2 so slots wrap with a mask.
+         * @param prototype Value every slot starts as.
+         */
+        HistoryRing(unsigned capacity, const T &prototype = T())
+            : entries(roundUp(capacity), prototype), head(0), count(0)
+        {
+        }
+
+        /**
+         * Takes a new checkpoint slot at the tail of the ring.
+         * @return The slot, or nullptr if every slot is held by a branch
+         * still in flight.
+         */
+        T *
+        take()
+        {
+            if (count == entries.size()) {
+                return nullptr;
+            }
+            unsigned slot = (head + count) & (entries.size() - 1);
+            count++;
+            return &entries[slot];
+        }
+
+        /**
+         * Releases the oldest in-flight checkpoint once its branch commits.
+         */
+        void
+        releaseOldest(T *entry)
+        {
+            assert(count > 0 && entry == &entries[head]);
+            head = (head + 1) & (entries.size() - 1);
+            count--;
+        }
+
+        /**
+         * Releases the youngest in-flight checkpoint when its branch is
+         * squashed.
+         */
+        void
+        releaseYoungest(T *entry)
+        {
+            assert(count > 0 &&
+                   entry == &entries[(head + count - 1) & (entries.size() - 1)]);
+            count--;
+        }
+
+        unsigned inFlight() const { return count; }
+        unsigned capacity() const { return entries.size(); }
+
+        /**
+         * @return The slots a ring asked for capacity checkpoints has.
+         */
+        static unsigned
+        roundUp(unsigned capacity)
+        {
+            unsigned size = 1;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            return size;
+        }
+
+    private:
+        std::vector<T> entries;         // Checkpoint storage, size is a power of 2
+        unsigned head;                  // Slot of the oldest in-flight checkpoint
+        unsigned count;                 // Number of in-flight checkpoints
+};
+
+/**
+ * One HistoryRing per thread plus the checks a predictor needs around
+ * them: a capacity of at least one checkpoint, a panic instead of a null
+ * checkpoint when a ring is full, and no branch in flight when the
+ * predictor is checkpointed.
+ */
+template <class T>
+class HistoryRings
+{
+    public:
+        /**
+         * @param owner Name of the predictor in error messages.
+         * @param capacity Checkpoints each thread can have in flight.
+         * @param prototype Value every slot starts as.
+         */
+        HistoryRings(const std::string &owner, unsigned numThreads,
+                     unsigned capacity, const T &prototype = T())
+            : owner(owner),
+              rings(numThreads,
+                    HistoryRing<T>(slotsFor(owner, capacity), prototype))
+        {
+        }
+
+        /**
+         * Checks the capacity, usable before the rings are built to size
+         * what has to hold the histories of every in-flight branch.
+         * @return The slots each ring has, capacity rounded up to a power
+         * of 2.
+         */
+        static unsigned
+        slotsFor(const std::string &owner, unsigned capacity)
+        {
+            fatal_if(capacity == 0,
+                     "%s needs at least one history checkpoint per thread!\n",
+                     owner);
+            return HistoryRing<T>::roundUp(capacity);
+        }
+
+        /**
+         * Takes a new checkpoint at the tail of the thread's ring.
+         * @return The checkpoint, used as the bp_history of the branch.
+         */
+        T *
+        take(ThreadID tid)
+        {
+            T *entry = rings[tid].take();
+            panic_if(!entry, "%s ran out of history checkpoints (%u in flight), "
+                     "increase historyCheckpoints!\n", owner, rings[tid].inFlight());
+            return entry;
+        }
+
+        /**
+         * Releases the checkpoint of a committed branch, always the oldest
+         * one in flight.
+         */
+        void commit(ThreadID tid, T *entry) { rings[tid].releaseOldest(entry); }
+
+        /**
+         * Releases the checkpoint of a squashed branch, squashes walk from
+         * the youngest branch backwards.
+         */
+        void squash(ThreadID tid, T *entry) { rings[tid].releaseYoungest(entry); }
+
+        /**
+         * Panics if any branch is in flight, the state of the predictor is
+         * only checkpointed while drained.
+         */
+        void
+        checkDrained() const
+        {
+            for (const HistoryRing<T> &ring : rings) {
+                panic_if(ring.inFlight(), "%s checkpointed with %u branches in flight\n",
+                         owner, ring.inFlight());
+            }
+        }
+
+    private:
+        const std::string owner;
+        std::vector<HistoryRing<T>> rings;
+};
+
+#endif // __CPU_PRED_HISTORY_RING_HH__
@@ -0,0 +1,189 @@
+#ifndef __CPU_PRED_PACKED_COUNTER_TABLE_HH__
+#define __CPU_PRED_PACKED_COUNTER_TABLE_HH__
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+/**
+ * Table of small saturating counters packed into 64-bit words. Each counter
+ * takes a lane of 1, 2, 4 or 8 bits, the smallest that fits its width, so a
+ * table of 2-bit counters uses a quarter of a byte per counter instead of
+ * the bytes of a SatCounter.
+ *
+ * Counters with neighbouring indices share a word, and the words are laid
+ * out from a 64-byte boundary so no word straddles two host cache lines. A
+ * predictor that puts the bits it looks up together in the low end of its
+ * index, like the history bits of GSelect, touches one line for all of them.
+ *
+ * Counters are read and updated inside the word holding them: the lane is
+ * extracted, saturated without branches and written back.
+ */
+class PackedCounterTable
+{
+    public:
+        /**
+         * @param entries Number of counters.
+         * @param bits Bits per counter, 1 to 8.
+         * @param initial Value every counter starts at.
+         */
+        PackedCounterTable(size_t entries, unsigned bits, uint8_t initial = 0)
+            : entries(entries),
+              laneShift(bits <= 1 ? 0 : bits <= 2 ? 1 : bits <= 4 ? 2 : 3),
+              laneBits(1u << laneShift),
+              lanesPerWordShift(6 - laneShift),
+              laneMask((1u << laneBits) - 1),
+              counterMax((1u << bits) - 1),
+              numWords((entries + (1 << lanesPerWordShift) - 1) >> lanesPerWordShift),
+              words(allocate(numWords))
+        {
+            uint64_t word = 0;
+            for (unsigned lane = 0; lane < 64u / laneBits; lane++) {
+                word |= uint64_t(initial & counterMax) << (lane * laneBits);
+            }
+            for (size_t i = 0; i < numWords; i++) {
+                words[i] = word;
+            }
+        }
+
+        PackedCounterTable(const PackedCounterTable &other)
+            : entries(other.entries), laneShift(other.laneShift),
+              laneBits(other.laneBits),
+              lanesPerWordShift(other.lanesPerWordShift),
+              laneMask(other.laneMask), counterMax(other.counterMax),
+              numWords(other.numWords), words(allocate(numWords))
+        {
+            memcpy(words, other.words, numWords * sizeof(uint64_t));
+        }
+
+        PackedCounterTable &operator=(const PackedCounterTable &) = delete;
+
+        ~PackedCounterTable() { free(words); }
+
+        /**
+         * @return The value of a counter.
+         */
+        uint8_t
+        read(size_t index) const
+        {
+            return (words[wordOf(index)] >> shiftOf(index)) & laneMask;
+        }
+
+        /**
+         * Sets a counter, the value is clamped to the counter width.
+         */
+        void
+        write(size_t index, uint8_t value)
+        {
+            uint64_t &word = words[wordOf(index)];
+            unsigned shift = shiftOf(index);
+            word = (word & ~(uint64_t(laneMask) << shift)) |
+                   (uint64_t(value < counterMax ? value : counterMax) << shift);
+        }
+
+        /**
+         * Moves a counter one step towards its maximum on taken and towards
+         * 0 otherwise, saturating at both ends.
+         */
+        void
+        update(size_t index, bool taken)
+        {
+            uint64_t &word = words[wordOf(index)];
+            unsigned shift = shiftOf(index);
+            unsigned value = (word >> shift) & laneMask;
+            uint64_t up = taken & (value < counterMax);     // 1 when the counter can go up
+            uint64_t down = !taken & (value > 0);           // 1 when the counter can go down
+            word = word + (up << shift) - (down << shift);  // Neither can carry out of the lane
+        }
+
+        /**
+         * Same as read() followed by update(), touching the word once.
+         * @return The value of the counter before the update.
+         */
+        uint8_t
+        readUpdate(size_t index, bool taken)
+        {
+            uint64_t &word = words[wordOf(index)];
+            unsigned shift = shiftOf(index);
+            unsigned value = (word >> shift) & laneMask;
+            uint64_t up = taken & (value < counterMax);
+            uint64_t down = !taken & (value > 0);
+            word = word + (up << shift) - (down << shift);
+            return value;
+        }
+
+        void increment(size_t index) { update(index, true); }
+        void decrement(size_t index) { update(index, false); }
+
+        /**
+         * @return Whether the most significant bit of a counter is set.
+         */
+        bool
+        isTaken(size_t index) const
+        {
+            return read(index) > counterMax / 2;
+        }
+
+        size_t size() const { return entries; }
+        uint8_t max() const { return counterMax; }
+
+        /**
+         * @return Host memory used by the counters.
+         */
+        size_t bytes() const { return numWords * sizeof(uint64_t); }
+
+        /**
+         * @return A copy of the packed words, for checkpoints.
+         */
+        std::vector<uint64_t>
+        saveWords() const
+        {
+            return std::vector<uint64_t>(words, words + numWords);
+        }
+
+        /**
+         * Restores the packed words of a table of the same size and width.
+         * @return False if the number of words does not match.
+         */
+        bool
+        restoreWords(const std::vector<uint64_t> &saved)
+        {
+            if (saved.size() != numWords) {
+                return false;
+            }
+            memcpy(words, saved.data(), numWords * sizeof(uint64_t));
+            return true;
+        }
+
+    private:
+        static uint64_t *
+        allocate(size_t numWords)
+        {
+            void *memory = nullptr;
+            if (posix_memalign(&memory, 64, (numWords ? numWords : 1) * sizeof(uint64_t))) {
+                throw std::bad_alloc();
+            }
+            return static_cast<uint64_t *>(memory);
+        }
+
+        size_t wordOf(size_t index) const { return index >> lanesPerWordShift; }
+
+        unsigned
+        shiftOf(size_t index) const
+        {
+            return (index & ((1u << lanesPerWordShift) - 1)) << laneShift;
+        }
+
+        const size_t entries;
+        const unsigned laneShift;           // log2 of the bits per lane
+        const unsigned laneBits;            // Bits per lane
+        const unsigned lanesPerWordShift;   // log2 of the lanes per word
+        const unsigned laneMask;            // Mask of one lane
+        const uint8_t counterMax;           // Value the counters saturate at
+        const size_t numWords;
+        uint64_t *words;                    // Counters, 64-byte aligned
+};
+
+#endif // __CPU_PRED_PACKED_COUNTER_TABLE_HH__
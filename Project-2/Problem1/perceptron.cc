@@ -0,0 +1,156 @@
+#include "cpu/pred/perceptron.hh"
+
+#include <cstdlib>
+
+namespace
+{
+
+/**
+ * Checks the geometry before the weights are allocated.
+ * @return The number of rows.
+ */
+unsigned
+checkedRows(const PerceptronBPParams *params)
+{
+    fatal_if(!PerceptronCore::validConfig(params->numRows, params->historyLength),
+             "Invalid perceptron row count or history length!\n");
+    return params->numRows;
+}
+
+} // anonymous namespace
+
+PerceptronBP::PerceptronBP(const PerceptronBPParams *params)
+    : BPredUnit(params),
+    core(checkedRows(params), params->historyLength, params->threshold,
+         params->instShiftAmt, params->numThreads,
+         HistoryRings<BPHistory>::slotsFor("Perceptron", params->historyCheckpoints)),
+    historyRings("Perceptron", params->numThreads, params->historyCheckpoints),
+    perceptronStats(*this)
+{
+    DPRINTF(Perceptron, "%u rows of %u weights, threshold %d\n",
+            core.numRows, core.historyLength, core.threshold);
+}
+
+bool PerceptronBP::lookup(ThreadID tid, Addr branch_addr, void * &bp_history)
+{
+    BPHistory *history = historyRings.take(tid);                // Checkpoint the history for the case of squash
+    bp_history = static_cast<void*>(history);
+    bool taken = core.lookup(tid, branch_addr, *history);       // Predict and shift the prediction into the global history
+    DPRINTF(Perceptron, "lookup %#x: row %u output %d\n", branch_addr,
+            history->row, history->output);
+    return taken;
+}
+
+void PerceptronBP::btbUpdate(ThreadID tid, Addr branch_addr, void * &bp_history)
+{
+    DPRINTF(Perceptron, "btbUpdate\n");
+    core.btbUpdate(tid, *static_cast<BPHistory*>(bp_history));   // Replace the newest history bit with not taken
+}
+
+void PerceptronBP::update(ThreadID tid, Addr branch_addr, bool taken, void *bp_history,
+                          bool squashed, const StaticInstPtr & inst, Addr corrTarget)
+{
+    assert(bp_history);
+
+    BPHistory *history = static_cast<BPHistory*>(bp_history);  // Checkpoint taken when the branch was predicted
+    // On a squash only the global history is repaired, like GSelectBP the
+    // weights are trained at commit with the history of the prediction
+    bool trained = core.update(tid, taken, *history, squashed);
+    if (squashed) {
+        DPRINTF(Perceptron, "squashed %#x\n", branch_addr);
+        return;
+    }
+
+    if (history->conditional) {
+        perceptronStats.trainings += trained;
+        if (std::abs(history->output) <= core.threshold) {
+            perceptronStats.lowConfidence++;
+        }
+    }
+    historyRings.commit(tid, history);
+}
+
+void PerceptronBP::squash(ThreadID tid, void *bp_history)
+{
+    if(bp_history==NULL)
+    {
+        return;
+    }
+    BPHistory *history = static_cast<BPHistory*>(bp_history);
+    core.squash(tid, *history);                                 // Restore the history recorded before the prediction
+    historyRings.squash(tid, history);
+}
+
+void PerceptronBP::uncondBranch(ThreadID tid, Addr pc, void * &bp_history)
+{
+    BPHistory *history = historyRings.take(tid);
+    bp_history = static_cast<void*>(history);
+    core.uncondBranch(tid, *history);                           // Shift taken into the global history
+}
+
+void PerceptronBP::serialize(CheckpointOut &cp) const
+{
+    historyRings.checkDrained();
+    /* Geometry the weights were checkpointed with, checked on restore */
+    unsigned numRows = core.numRows;
+    unsigned historyLength = core.historyLength;
+    SERIALIZE_SCALAR(numRows);
+    SERIALIZE_SCALAR(historyLength);
+
+    std::vector<int> weights(core.weights.begin(), core.weights.end());
+    std::vector<int> biases(core.biases.begin(), core.biases.end());
+    SERIALIZE_CONTAINER(weights);
+    SERIALIZE_CONTAINER(biases);
+
+    /* Global histories of all threads, back to back */
+    std::vector<unsigned> historyBits, positions;
+    for (const PerceptronCore::Thread &thread : core.threads) {
+        historyBits.insert(historyBits.end(), thread.buffer.begin(), thread.buffer.end());
+        positions.push_back(thread.position);
+    }
+    SERIALIZE_CONTAINER(historyBits);
+    SERIALIZE_CONTAINER(positions);
+}
+
+void PerceptronBP::unserialize(CheckpointIn &cp)
+{
+    unsigned numRows, historyLength;
+    UNSERIALIZE_SCALAR(numRows);
+    UNSERIALIZE_SCALAR(historyLength);
+    fatal_if(numRows != core.numRows || historyLength != core.historyLength,
+             "Perceptron checkpoint has %u rows of %u weights, the predictor %u of %u\n",
+             numRows, historyLength, core.numRows, core.historyLength);
+
+    std::vector<int> weights, biases;
+    UNSERIALIZE_CONTAINER(weights);
+    UNSERIALIZE_CONTAINER(biases);
+    fatal_if(weights.size() != core.weights.size() || biases.size() != core.biases.size(),
+             "Perceptron checkpoint weights are corrupt\n");
+    core.weights.assign(weights.begin(), weights.end());
+    core.biases.assign(biases.begin(), biases.end());
+
+    std::vector<unsigned> historyBits, positions;
+    UNSERIALIZE_CONTAINER(historyBits);
+    UNSERIALIZE_CONTAINER(positions);
+    size_t bufferSize = core.threads[0].buffer.size();
+    fatal_if(historyBits.size() != bufferSize * core.threads.size() ||
+             positions.size() != core.threads.size(),
+             "Perceptron checkpoint global histories are corrupt\n");
+    for (size_t t = 0; t < core.threads.size(); t++) {
+        core.threads[t].buffer.assign(historyBits.begin() + t * bufferSize,
+                                      historyBits.begin() + (t + 1) * bufferSize);
+        core.threads[t].position = positions[t];
+    }
+}
+
+PerceptronBP::PerceptronStats::PerceptronStats(PerceptronBP &parent)
+    : Stats::Group(&parent, "perceptron"),
+      ADD_STAT(trainings, "Number of committed conditional branches that trained their weights"),
+      ADD_STAT(lowConfidence, "Number of committed conditional branches predicted with an output within the training threshold")
+{
+}
+
+PerceptronBP* PerceptronBPParams::create()
+{
+    return new PerceptronBP(this);
+}
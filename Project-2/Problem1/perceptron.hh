@@ -0,0 +1,93 @@
+#ifndef __CPU_PRED_PERCEPTRON_HH__
+#define __CPU_PRED_PERCEPTRON_HH__
+
+#include <vector>
+
+#include "base/statistics.hh"
+#include "base/types.hh"
+#include "cpu/pred/bpred_unit.hh"
+#include "cpu/pred/history_ring.hh"
+#include "cpu/pred/perceptron_core.hh"
+#include "params/PerceptronBP.hh"
+#include "sim/serialize.hh"
+#include "debug/Perceptron.hh"
+
+/**
+ * Global history perceptron predictor, with rows of weights selected by a
+ * hash of the branch address and SIMD dot products on the host so long
+ * histories stay cheap to simulate. History checkpoints and squash
+ * recovery work like in GSelectBP.
+ */
+class PerceptronBP : public BPredUnit
+{
+    public:
+        PerceptronBP(const PerceptronBPParams *params);
+
+        /**
+         * Restores the global history recorded before the prediction.
+         * @param bp_history The checkpoint of the squashed branch.
+         */
+        void squash(ThreadID tid, void *bp_history);
+
+        /**
+         * Updates the predictor with the actual result of a branch.
+         * @param branch_addr The address of the branch to update.
+         * @param taken Whether or not the branch was taken.
+         * @param bp_history The checkpoint of the branch.
+         * @param squashed Whether any outstanding updates are squashed or not.
+         */
+        void update(ThreadID tid, Addr branch_addr, bool taken, void *bp_history,
+                    bool squashed, const StaticInstPtr & inst, Addr corrTarget);
+
+        /**
+         * Shifts an unconditional branch into the global history as taken.
+         * @param bp_history Set to the checkpoint of the branch.
+         */
+        void uncondBranch(ThreadID tid, Addr pc, void * &bp_history);
+
+        /**
+         * Turns the newest history bit into not taken if a BTB entry is
+         * invalid or not found.
+         * @param bp_history The checkpoint of the branch.
+         */
+        void btbUpdate(ThreadID tid, Addr branch_addr, void * &bp_history);
+
+        /**
+         * Computes the output of the branch's row of weights.
+         * @param branch_addr The address of the branch to look up.
+         * @param bp_history Set to the checkpoint of the branch.
+         * @return Whether or not the branch is taken.
+         */
+        bool lookup(ThreadID tid, Addr branch_addr, void * &bp_history);
+
+        /**
+         * Checkpoints the weights and the global histories. Only taken while
+         * drained, with no branch in flight.
+         */
+        void serialize(CheckpointOut &cp) const override;
+
+        /**
+         * Restores the weights and the global histories of a predictor with
+         * the same number of rows and history length.
+         */
+        void unserialize(CheckpointIn &cp) override;
+
+    private:
+        typedef PerceptronCore::Checkpoint BPHistory;
+
+        struct PerceptronStats : public Stats::Group
+        {
+            PerceptronStats(PerceptronBP &parent);
+
+            /** Committed conditional branches that trained their row */
+            Stats::Scalar trainings;
+            /** Committed conditional branches whose output was within the threshold */
+            Stats::Scalar lowConfidence;
+        };
+
+        PerceptronCore core;                        // Weights, global histories and SIMD kernels
+        HistoryRings<BPHistory> historyRings;       // Per-thread in-flight history checkpoints
+        PerceptronStats perceptronStats;
+};
+
+#endif // __CPU_PRED_PERCEPTRON_HH__
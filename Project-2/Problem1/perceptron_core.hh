@@ -0,0 +1,328 @@
+#ifndef __CPU_PRED_PERCEPTRON_CORE_HH__
+#define __CPU_PRED_PERCEPTRON_CORE_HH__
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * State and prediction logic of a global history perceptron predictor. A
+ * branch address is hashed to a row of signed 8-bit weights, one per bit of
+ * global history plus a bias. The prediction is taken when the bias plus the
+ * dot product of the weights with the history, taken counting as +1 and not
+ * taken as -1, is not negative. On a misprediction, or when the output was
+ * within the training threshold, each weight moves one step towards
+ * agreeing with the outcome.
+ *
+ * Everything a prediction touches is laid out for 16-byte SIMD lanes: rows
+ * are padded to a multiple of 16 weights, and global history is kept one
+ * byte per bit, 0xFF for taken, in a buffer that stores every bit twice so
+ * the newest bits are always contiguous. The dot product and the training
+ * step are then a few vector operations per 16 bits of history, SSE2 on x86
+ * hosts, with a scalar version giving the same results elsewhere. The
+ * weights of the padding lanes are never trained and stay 0.
+ *
+ * A checkpoint only holds the buffer position: the bits younger than it are
+ * not overwritten while it is in flight since the buffer holds the history
+ * plus every in-flight branch. Like GSelectCore it has no dependency on the
+ * rest of gem5 and leaves keeping the checkpoints to the caller.
+ */
+class PerceptronCore
+{
+    public:
+        /**
+         * History a branch was predicted with and its output, enough to
+         * repair the history and train the row later.
+         */
+        struct Checkpoint
+        {
+            unsigned position;          // Buffer position of the newest history bit
+            uint32_t row;               // Row of weights the branch was predicted with
+            int32_t output;             // Bias plus dot product
+            bool taken;                 // Final prediction
+            bool conditional;           // False for unconditional branches, which train nothing
+        };
+
+        /**
+         * @param numRows Rows of weights, a power of 2.
+         * @param historyLength Global history bits, 1 to 1024.
+         * @param threshold Outputs up to this magnitude still train, 0 for
+         * the usual 1.93 * historyLength + 14.
+         * @param instShiftAmt Low branch address bits that are always 0.
+         * @param numThreads Number of global histories.
+         * @param maxInFlight Checkpoints a thread can have in flight.
+         */
+        PerceptronCore(unsigned numRows, unsigned historyLength,
+                       unsigned threshold, unsigned instShiftAmt,
+                       unsigned numThreads, unsigned maxInFlight)
+            : numRows(numRows),
+              historyLength(historyLength),
+              rowStride((historyLength + 15) & ~15u),
+              threshold(threshold ? threshold : int32_t(1.93 * historyLength + 14)),
+              instShiftAmt(instShiftAmt),
+              rowBits(log2(numRows)),
+              weights(size_t(numRows) * rowStride, 0),
+              biases(numRows, 0),
+              valid(rowStride, 0)
+        {
+            for (unsigned i = 0; i < historyLength; i++) {
+                valid[i] = 0xFF;
+            }
+            bufferSize = 1u << log2(historyLength + maxInFlight + 1);
+            threads.assign(numThreads, Thread());
+            for (Thread &thread : threads) {
+                // Doubled so any window is contiguous, plus a chunk of slack
+                thread.buffer.assign(2 * bufferSize + 16, 0);
+                thread.position = 0;
+            }
+        }
+
+        /**
+         * @return Whether the parameters describe a usable predictor.
+         */
+        static bool
+        validConfig(unsigned numRows, unsigned historyLength)
+        {
+            bool powerOf2 = numRows && !(numRows & (numRows - 1));
+            return powerOf2 && numRows <= (1u << 24) &&
+                historyLength >= 1 && historyLength <= 1024;
+        }
+
+        /**
+         * Predicts a conditional branch and shifts the prediction into the
+         * thread's global history.
+         * @param checkpoint Filled with the history and the output the
+         * branch is predicted with.
+         * @return Whether or not the branch is predicted taken.
+         */
+        bool
+        lookup(unsigned tid, uint64_t branch_addr, Checkpoint &checkpoint)
+        {
+            checkpoint.position = threads[tid].position;
+            checkpoint.row = rowOf(branch_addr);
+            checkpoint.output = biases[checkpoint.row] +
+                dot(rowWeights(checkpoint.row), window(tid, checkpoint.position));
+            checkpoint.taken = checkpoint.output >= 0;
+            checkpoint.conditional = true;
+            push(tid, checkpoint.taken);
+            return checkpoint.taken;
+        }
+
+        /**
+         * Shifts an unconditional, always taken branch into the thread's
+         * global history.
+         * @param checkpoint Filled with the history before the branch.
+         */
+        void
+        uncondBranch(unsigned tid, Checkpoint &checkpoint)
+        {
+            checkpoint.position = threads[tid].position;
+            checkpoint.row = 0;
+            checkpoint.output = 0;
+            checkpoint.taken = true;
+            checkpoint.conditional = false;
+            push(tid, true);
+        }
+
+        /**
+         * Turns the newest history bit into not taken, used when the BTB has
+         * no target for a branch predicted taken.
+         * @param checkpoint The checkpoint of that branch.
+         */
+        void
+        btbUpdate(unsigned tid, const Checkpoint &checkpoint)
+        {
+            threads[tid].position = checkpoint.position;
+            push(tid, false);
+        }
+
+        /**
+         * Updates the predictor with the actual outcome of a branch.
+         * @param checkpoint The checkpoint the branch was predicted with.
+         * @param squashed True when the branch was mispredicted and the
+         * younger branches are being squashed: only the history is
+         * repaired, the weights are trained at commit.
+         * @return Whether the weights were trained.
+         */
+        bool
+        update(unsigned tid, bool taken, const Checkpoint &checkpoint,
+               bool squashed)
+        {
+            if (squashed) {
+                threads[tid].position = checkpoint.position;
+                push(tid, taken);
+                return false;
+            }
+            if (!checkpoint.conditional ||
+                (checkpoint.taken == taken &&
+                 std::abs(checkpoint.output) > threshold)) {
+                return false;
+            }
+            train(rowWeights(checkpoint.row), window(tid, checkpoint.position), taken);
+            int8_t &bias = biases[checkpoint.row];
+            if (taken ? bias < 127 : bias > -128) {
+                bias += taken ? 1 : -1;
+            }
+            return true;
+        }
+
+        /**
+         * Restores the global history of a squashed branch.
+         * @param checkpoint The checkpoint the branch was predicted with.
+         */
+        void
+        squash(unsigned tid, const Checkpoint &checkpoint)
+        {
+            threads[tid].position = checkpoint.position;
+        }
+
+        /**
+         * @return Bias-less output of a row of weights for a history
+         * window, vectorized where the host allows.
+         */
+        int32_t
+        dot(const int8_t *row, const uint8_t *history) const
+        {
+#if defined(__SSE2__)
+            __m128i sum = _mm_setzero_si128();
+            for (unsigned i = 0; i < rowStride; i += 16) {
+                __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+                __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(history + i));
+                // Not taken bits negate their weight: (w ^ m) - m with m all
+                // ones, done in 16 bits so -128 negates without overflowing
+                __m128i m = _mm_xor_si128(h, _mm_set1_epi8(-1));
+                __m128i wLow = _mm_srai_epi16(_mm_unpacklo_epi8(w, w), 8);
+                __m128i wHigh = _mm_srai_epi16(_mm_unpackhi_epi8(w, w), 8);
+                __m128i mLow = _mm_srai_epi16(_mm_unpacklo_epi8(m, m), 8);
+                __m128i mHigh = _mm_srai_epi16(_mm_unpackhi_epi8(m, m), 8);
+                sum = _mm_add_epi16(sum, _mm_sub_epi16(_mm_xor_si128(wLow, mLow), mLow));
+                sum = _mm_add_epi16(sum, _mm_sub_epi16(_mm_xor_si128(wHigh, mHigh), mHigh));
+            }
+            // Each 16-bit lane holds at most 128 terms of magnitude 128,
+            // widen to 32 bits before adding the lanes up
+            sum = _mm_madd_epi16(sum, _mm_set1_epi16(1));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_cvtsi128_si32(sum);
+#else
+            return dotScalar(row, history);
+#endif
+        }
+
+        /**
+         * Moves each valid weight of a row one step towards agreeing with
+         * the outcome, saturating at -128 and 127.
+         */
+        void
+        train(int8_t *row, const uint8_t *history, bool taken) const
+        {
+#if defined(__SSE2__)
+            __m128i outcome = _mm_set1_epi8(taken ? -1 : 0);
+            __m128i one = _mm_set1_epi8(1);
+            for (unsigned i = 0; i < rowStride; i += 16) {
+                __m128i *w = reinterpret_cast<__m128i *>(row + i);
+                __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(history + i));
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&valid[i]));
+                // +1 where the history bit agrees with the outcome, -1
+                // where it does not, 0 in the padding lanes
+                __m128i disagree = _mm_xor_si128(h, outcome);
+                __m128i step = _mm_sub_epi8(_mm_xor_si128(one, disagree), disagree);
+                step = _mm_and_si128(step, v);
+                _mm_storeu_si128(w, _mm_adds_epi8(_mm_loadu_si128(w), step));
+            }
+#else
+            trainScalar(row, history, taken);
+#endif
+        }
+
+        /**
+         * Scalar dot product, the reference the vector kernel matches.
+         */
+        int32_t
+        dotScalar(const int8_t *row, const uint8_t *history) const
+        {
+            int32_t sum = 0;
+            for (unsigned i = 0; i < historyLength; i++) {
+                sum += history[i] ? row[i] : -row[i];
+            }
+            return sum;
+        }
+
+        /**
+         * Scalar training step, the reference the vector kernel matches.
+         */
+        void
+        trainScalar(int8_t *row, const uint8_t *history, bool taken) const
+        {
+            for (unsigned i = 0; i < historyLength; i++) {
+                int value = row[i] + (bool(history[i]) == taken ? 1 : -1);
+                row[i] = value > 127 ? 127 : value < -128 ? -128 : value;
+            }
+        }
+
+        int8_t *rowWeights(uint32_t row) { return &weights[size_t(row) * rowStride]; }
+
+        /**
+         * @return The history bits of a thread newest first, as of a buffer
+         * position.
+         */
+        const uint8_t *
+        window(unsigned tid, unsigned position) const
+        {
+            return &threads[tid].buffer[position];
+        }
+
+        uint32_t
+        rowOf(uint64_t branch_addr) const
+        {
+            uint64_t pc = branch_addr >> instShiftAmt;
+            return (pc ^ (pc >> rowBits) ^ (pc >> (2 * rowBits))) & (numRows - 1);
+        }
+
+        /**
+         * Global history of one thread.
+         */
+        struct Thread
+        {
+            std::vector<uint8_t> buffer;    // History bytes, each at position and position + bufferSize
+            unsigned position;              // Slot of the newest byte, moves down
+        };
+
+        const unsigned numRows;
+        const unsigned historyLength;
+        const unsigned rowStride;                   // Weights per row including padding, a multiple of 16
+        const int32_t threshold;                    // Training threshold on the output magnitude
+        const unsigned instShiftAmt;
+        const unsigned rowBits;                     // log2 of numRows
+        std::vector<int8_t> weights;                // Rows of history weights, rowStride apart
+        std::vector<int8_t> biases;                 // Bias weight of each row
+        std::vector<uint8_t> valid;                 // 0xFF in the lanes of a row holding history weights
+        std::vector<Thread> threads;
+        unsigned bufferSize;                        // History slots, a power of 2
+
+    private:
+        static unsigned
+        log2(unsigned value)
+        {
+            unsigned bits = 0;
+            while ((1u << bits) < value) {
+                bits++;
+            }
+            return bits;
+        }
+
+        void
+        push(unsigned tid, bool taken)
+        {
+            Thread &thread = threads[tid];
+            thread.position = (thread.position - 1) & (bufferSize - 1);
+            thread.buffer[thread.position] = taken ? 0xFF : 0;
+            thread.buffer[thread.position + bufferSize] = taken ? 0xFF : 0;
+        }
+};
+
+#endif // __CPU_PRED_PERCEPTRON_CORE_HH__
@@ -0,0 +1,11 @@
+from m5.params import *
+from m5.proxy import *
+from m5.objects.Probe import ProbeListenerObject
+
+class AccessTraceProbe(ProbeListenerObject):
+    type = 'AccessTraceProbe'
+    cxx_class = 'AccessTraceProbe'
+    cxx_header = "mem/cache/replacement_policies/access_trace_probe.hh"
+    traceFile = Param.String("File in the output directory to record the cache's accesses to for cache_replay")
+    blkSize = Param.Unsigned(Parent.cache_line_size, "Block size of the cache")
+    assoc = Param.Unsigned(Parent.assoc, "Set associativity of the cache")
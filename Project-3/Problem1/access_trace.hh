@@ -0,0 +1,173 @@
+#ifndef __MEM_CACHE_REPLACEMENT_POLICIES_ACCESS_TRACE_HH__
+#define __MEM_CACHE_REPLACEMENT_POLICIES_ACCESS_TRACE_HH__
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Binary trace of the accesses seen by one cache. The file is a 16-byte
+ * header followed by fixed-size 16-byte records in the order the cache saw
+ * them, so it can be written as a stream and mapped straight into memory
+ * for replay. The number of records follows from the file size.
+ */
+namespace AccessTrace
+{
+
+const char magic[8] = {'C', 'A', 'C', 'H', 'E', 'T', 'R', '1'};
+
+struct Header
+{
+    char magic[8];
+    uint32_t blkSize;           // Block size of the recording cache
+    uint32_t assoc;             // Associativity of the recording cache
+};
+
+/* What the cache did with the access */
+enum Event : uint8_t
+{
+    Hit = 0,
+    Miss = 1,
+    Fill = 2
+};
+
+/* Kind of request, writebacks and clean evictions do not count as accesses
+ * in the overall miss rate */
+enum Type : uint8_t
+{
+    Read = 0,
+    Write = 1,
+    Prefetch = 2,
+    Writeback = 3,
+    CleanEvict = 4
+};
+
+struct Record
+{
+    uint64_t addr;              // Address of the access
+    uint32_t pc;                // Low bits of the PC of the instruction behind the access, 0 if unknown
+    uint16_t requestor;         // Requestor id of the access
+    uint8_t event;              // Event
+    uint8_t type;               // Type
+};
+
+static_assert(sizeof(Record) == 16, "Access trace records must stay 16 bytes");
+
+/**
+ * Appends records to a trace file through stdio buffering.
+ */
+class Writer
+{
+    public:
+        Writer() : file(nullptr) {}
+        Writer(const Writer &) = delete;
+        Writer &operator=(const Writer &) = delete;
+        ~Writer() { close(); }
+
+        /**
+         * Creates the trace file and writes its header.
+         * @return False if the file could not be created.
+         */
+        bool
+        open(const std::string &path, unsigned blkSize, unsigned assoc)
+        {
+            file = fopen(path.c_str(), "wb");
+            if (!file) {
+                return false;
+            }
+            setvbuf(file, nullptr, _IOFBF, 1 << 20);
+            Header header;
+            memcpy(header.magic, magic, sizeof(magic));
+            header.blkSize = blkSize;
+            header.assoc = assoc;
+            fwrite(&header, sizeof(header), 1, file);
+            return true;
+        }
+
+        bool isOpen() const { return file; }
+
+        void
+        append(const Record &record)
+        {
+            fwrite(&record, sizeof(record), 1, file);
+        }
+
+        void
+        close()
+        {
+            if (file) {
+                fclose(file);
+                file = nullptr;
+            }
+        }
+
+    private:
+        FILE *file;
+};
+
+/**
+ * Read-only view of a whole trace file, mapped into memory.
+ */
+class Reader
+{
+    public:
+        Reader() : base(nullptr), length(0) {}
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+        ~Reader() { if (base) munmap(base, length); }
+
+        /**
+         * Maps a trace file and checks its header.
+         * @return An error message, empty on success.
+         */
+        std::string
+        open(const std::string &path)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                return path + ": cannot open";
+            }
+            struct stat st;
+            fstat(fd, &st);
+            length = st.st_size;
+            if (length < sizeof(Header)) {
+                ::close(fd);
+                return path + ": too short for an access trace";
+            }
+            base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (base == MAP_FAILED) {
+                base = nullptr;
+                return path + ": cannot map";
+            }
+            if (memcmp(header().magic, magic, sizeof(magic))) {
+                return path + ": not a cache access trace";
+            }
+            return "";
+        }
+
+        const Header &header() const { return *static_cast<const Header *>(base); }
+
+        const Record *
+        records() const
+        {
+            return reinterpret_cast<const Record *>(
+                static_cast<const char *>(base) + sizeof(Header));
+        }
+
+        size_t size() const { return (length - sizeof(Header)) / sizeof(Record); }
+
+    private:
+        void *base;
+        size_t length;
+};
+
+} // namespace AccessTrace
+
+#endif // __MEM_CACHE_REPLACEMENT_POLICIES_ACCESS_TRACE_HH__
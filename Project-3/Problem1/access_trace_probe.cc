@@ -0,0 +1,54 @@
+#include "mem/cache/replacement_policies/access_trace_probe.hh"
+
+#include "base/logging.hh"
+#include "base/output.hh"
+#include "params/AccessTraceProbe.hh"
+
+/* Constructor for class AccessTraceProbe */
+AccessTraceProbe::AccessTraceProbe(const Params *p)
+    : ProbeListenerObject(p)
+{
+    if(!trace.open(simout.resolve(p->traceFile), p->blkSize, p->assoc)) {
+        fatal("Cannot create cache access trace %s\n", p->traceFile);
+    }
+}
+
+void
+AccessTraceProbe::regProbeListeners()
+{
+    /* The listeners register with the probe manager of the cache given as manager */
+    listeners.push_back(new ProbeListenerArg<AccessTraceProbe, PacketPtr>(
+        this, "Hit", &AccessTraceProbe::recordHit));
+    listeners.push_back(new ProbeListenerArg<AccessTraceProbe, PacketPtr>(
+        this, "Miss", &AccessTraceProbe::recordMiss));
+    listeners.push_back(new ProbeListenerArg<AccessTraceProbe, PacketPtr>(
+        this, "Fill", &AccessTraceProbe::recordFill));
+}
+
+void
+AccessTraceProbe::record(const PacketPtr &pkt, AccessTrace::Event event)
+{
+    AccessTrace::Record record;
+    record.addr = pkt->getAddr();
+    record.pc = pkt->req->hasPC() ? pkt->req->getPC() : 0;             // Kept for PC-based policies, most requests below the L1s carry none
+    record.requestor = pkt->req->requestorId();
+    record.event = event;
+    if(pkt->cmd == MemCmd::CleanEvict) {
+        record.type = AccessTrace::CleanEvict;
+    } else if(pkt->isWriteback()) {
+        record.type = AccessTrace::Writeback;
+    } else if(pkt->req->isPrefetch()) {
+        record.type = AccessTrace::Prefetch;
+    } else if(pkt->isWrite() || pkt->needsWritable()) {
+        record.type = AccessTrace::Write;
+    } else {
+        record.type = AccessTrace::Read;
+    }
+    trace.append(record);
+}
+
+AccessTraceProbe*
+AccessTraceProbeParams::create()
+{
+    return new AccessTraceProbe(this);
+}
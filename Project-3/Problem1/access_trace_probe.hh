@@ -0,0 +1,44 @@
+#ifndef __MEM_CACHE_REPLACEMENT_POLICIES_ACCESS_TRACE_PROBE_HH__
+#define __MEM_CACHE_REPLACEMENT_POLICIES_ACCESS_TRACE_PROBE_HH__
+
+#include "mem/cache/replacement_policies/access_trace.hh"
+#include "mem/packet.hh"
+#include "sim/probe/probe.hh"
+
+struct AccessTraceProbeParams;
+
+/**
+ * Records the accesses a cache sees to an access trace, for replay with
+ * util/cache_replay against other geometries and replacement policies.
+ * It listens to the Hit, Miss and Fill probe points of the cache it is
+ * attached to, e.g.
+ *     system.l2.accessTrace = AccessTraceProbe(traceFile="l2.trace")
+ */
+class AccessTraceProbe : public ProbeListenerObject
+{
+    public:
+
+    typedef AccessTraceProbeParams Params;
+
+    AccessTraceProbe(const Params *p);
+
+    /** Hooks the listeners up to the cache's probe points */
+    void regProbeListeners() override;
+
+    private:
+
+    /**
+     * Appends one access to the trace.
+     * @param pkt The packet the cache notified about.
+     * @param event What the cache did with it.
+     */
+    void record(const PacketPtr &pkt, AccessTrace::Event event);
+
+    void recordHit(const PacketPtr &pkt) { record(pkt, AccessTrace::Hit); }
+    void recordMiss(const PacketPtr &pkt) { record(pkt, AccessTrace::Miss); }
+    void recordFill(const PacketPtr &pkt) { record(pkt, AccessTrace::Fill); }
+
+    AccessTrace::Writer trace;  // Trace file, open for the whole simulation
+};
+
+#endif // __MEM_CACHE_REPLACEMENT_POLICIES_ACCESS_TRACE_PROBE_HH__
@@ -0,0 +1,259 @@
+/**
+ * Standalone replay of cache access traces over many cache geometries and
+ * replacement policies at once.
+ *
+ * Record a trace by attaching an AccessTraceProbe to a cache, e.g.
+ *     system.l2.accessTrace = AccessTraceProbe(traceFile="l2.trace")
+ * and build the tool from the root of the gem5 tree:
+ *     g++ -O3 -std=c++14 -pthread -Isrc util/cache_replay.cc \
+ *         -o cache_replay
+ *
+ * Usage:
+ *     cache_replay [-j threads] [-s sizes] [-a assocs] [-b block size]
+ *                  [-p policies] [-i ipv]... trace...
+ * Sizes and associativities are comma separated lists, policies a comma
+ * separated list of lru, plru and ipv. Each -i gives one comma separated
+ * IPV, which is replayed for the associativity it has entries for; without
+ * any, ipv uses the default IPV of LRUIPVRP on 16-way caches. The block
+ * size defaults to the one the first trace was recorded with.
+ *
+ * Every combination is replayed against every trace and printed in the
+ * format of stats.txt, one block per trace and geometry, in the order they
+ * were requested. Each access is completed before the next one starts, so
+ * there are no MSHR merges and the replay is the cache seeing an ideal,
+ * blocking lower level.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mem/cache/replacement_policies/access_trace.hh"
+#include "mem/cache/replacement_policies/cache_replay.hh"
+
+namespace
+{
+
+struct Config
+{
+    uint64_t size;
+    unsigned assoc;
+    CacheReplay::Policy policy;
+    int ipv;                    // Index of the IPV in ipvs, -1 if none
+};
+
+/* Default IPV of LRUIPVRP */
+const std::vector<int> defaultIPV = {0, 0, 1, 0, 3, 0, 1, 2, 1, 0, 5, 1, 0, 0, 1, 11, 13};
+
+std::vector<uint64_t>
+parseList(const char *arg)
+{
+    std::vector<uint64_t> values;
+    std::string list(arg);
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        values.push_back(std::stoull(list.substr(start, end - start)));
+        start = end + 1;
+    }
+    return values;
+}
+
+std::vector<std::string>
+parseNames(const char *arg)
+{
+    std::vector<std::string> names;
+    std::string list(arg);
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        names.push_back(list.substr(start, end - start));
+        start = end + 1;
+    }
+    return names;
+}
+
+/**
+ * @return The name of a trace file without directory and extension.
+ */
+std::string
+traceName(const std::string &path)
+{
+    std::string name = path.substr(path.find_last_of('/') + 1);
+    return name.substr(0, name.find('.'));
+}
+
+void
+printStat(const std::string &name, const std::string &value,
+          const char *desc)
+{
+    printf("%-40s %12s %10s %10s # %s\n", name.c_str(), value.c_str(), "",
+           "", desc);
+}
+
+void
+usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-j threads] [-s sizes] [-a assocs] "
+            "[-b block size] [-p policies] [-i ipv]... trace...\n", name);
+    exit(1);
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char **argv)
+{
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<uint64_t> sizes = {262144, 524288, 1048576, 2097152};
+    std::vector<uint64_t> assocs = {16};
+    unsigned blkSize = 0;
+    std::vector<std::string> policies = {"lru", "plru", "ipv"};
+    std::vector<std::vector<int>> ipvs;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg[0] != '-') {
+            paths.push_back(arg);
+            continue;
+        }
+        if (i + 1 == argc) {
+            usage(argv[0]);
+        }
+        if (arg == "-j") {
+            threads = std::max(1ul, std::stoul(argv[++i]));
+        } else if (arg == "-s") {
+            sizes = parseList(argv[++i]);
+        } else if (arg == "-a") {
+            assocs = parseList(argv[++i]);
+        } else if (arg == "-b") {
+            blkSize = std::stoul(argv[++i]);
+        } else if (arg == "-p") {
+            policies = parseNames(argv[++i]);
+        } else if (arg == "-i") {
+            std::vector<uint64_t> ipv = parseList(argv[++i]);
+            ipvs.emplace_back(ipv.begin(), ipv.end());
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (paths.empty()) {
+        usage(argv[0]);
+    }
+    if (ipvs.empty()) {
+        ipvs.push_back(defaultIPV);
+    }
+
+    std::vector<AccessTrace::Reader> traces(paths.size());
+    for (size_t t = 0; t < paths.size(); t++) {
+        std::string error = traces[t].open(paths[t]);
+        if (!error.empty()) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        if (!blkSize) {
+            blkSize = traces[t].header().blkSize;
+        }
+    }
+
+    std::vector<Config> configs;
+    for (uint64_t size : sizes) {
+        for (uint64_t assoc : assocs) {
+            for (const std::string &policy : policies) {
+                std::vector<Config> candidates;
+                if (policy == "lru") {
+                    candidates.push_back(Config{size, unsigned(assoc), CacheReplay::LRU, -1});
+                } else if (policy == "plru") {
+                    candidates.push_back(Config{size, unsigned(assoc), CacheReplay::TreePLRU, -1});
+                } else if (policy == "ipv") {
+                    for (size_t v = 0; v < ipvs.size(); v++) {
+                        if (ipvs[v].size() == assoc + 1) {
+                            candidates.push_back(Config{size, unsigned(assoc), CacheReplay::LRUIPV, int(v)});
+                        }
+                    }
+                } else {
+                    fprintf(stderr, "unknown policy %s\n", policy.c_str());
+                    return 1;
+                }
+                for (const Config &config : candidates) {
+                    std::string error = CacheReplay::validConfig(
+                        config.size, config.assoc, blkSize, config.policy,
+                        config.ipv < 0 ? std::vector<int>() : ipvs[config.ipv]);
+                    if (!error.empty()) {
+                        fprintf(stderr, "skipping size=%lu assoc=%u %s: %s\n",
+                                (unsigned long)config.size, config.assoc,
+                                policy.c_str(), error.c_str());
+                        continue;
+                    }
+                    configs.push_back(config);
+                }
+            }
+        }
+    }
+
+    // Every (trace, geometry) pair is an independent job, workers pull the
+    // next one until none is left.
+    size_t jobs = traces.size() * configs.size();
+    std::vector<CacheReplay::Stats> results(jobs);
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < std::min<size_t>(threads, jobs); w++) {
+        workers.emplace_back([&]() {
+            for (size_t job = next++; job < jobs; job = next++) {
+                const AccessTrace::Reader &trace = traces[job / configs.size()];
+                const Config &config = configs[job % configs.size()];
+                CacheReplay cache(config.size, config.assoc, blkSize,
+                                  config.policy,
+                                  config.ipv < 0 ? std::vector<int>() : ipvs[config.ipv]);
+                cache.replay(trace.records(), trace.size(), results[job]);
+            }
+        });
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    const char *policyNames[] = {"lru", "plru", "ipv"};
+    for (size_t v = 0; v < ipvs.size(); v++) {
+        printf("# ipv%lu:", (unsigned long)v);
+        for (int position : ipvs[v]) {
+            printf(" %d", position);
+        }
+        printf("\n");
+    }
+    for (size_t job = 0; job < jobs; job++) {
+        const Config &config = configs[job % configs.size()];
+        const CacheReplay::Stats &result = results[job];
+        std::string name = traceName(paths[job / configs.size()]) + ".l2_" +
+            std::to_string(config.size) + "_" + std::to_string(config.assoc) +
+            "way_" + policyNames[config.policy] +
+            (config.ipv < 0 ? "" : std::to_string(config.ipv));
+        uint64_t accesses = result.hits + result.misses;
+        char rate[32];
+        snprintf(rate, sizeof(rate), "%f",
+                 accesses ? double(result.misses) / accesses : 0.0);
+
+        printStat(name + ".overall_hits::total", std::to_string(result.hits),
+                  "number of overall hits");
+        printStat(name + ".overall_misses::total",
+                  std::to_string(result.misses), "number of overall misses");
+        printStat(name + ".overall_accesses::total", std::to_string(accesses),
+                  "number of overall (read+write) accesses");
+        printStat(name + ".overall_miss_rate::total", rate,
+                  "miss rate for overall accesses");
+        printStat(name + ".replacements", std::to_string(result.replacements),
+                  "number of replacements");
+    }
+    return 0;
+}
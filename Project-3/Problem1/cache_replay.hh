@@ -0,0 +1,242 @@
+#ifndef __MEM_CACHE_REPLACEMENT_POLICIES_CACHE_REPLAY_HH__
+#define __MEM_CACHE_REPLACEMENT_POLICIES_CACHE_REPLAY_HH__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mem/cache/replacement_policies/access_trace.hh"
+#include "mem/cache/replacement_policies/lru_ipv_set.hh"
+
+/**
+ * Set-associative cache model for replaying access traces offline. It keeps
+ * only tags and replacement state, indexes sets like the default
+ * SetAssociative indexing policy and replaces blocks like the gem5 policy
+ * it stands for:
+ *  - LRU and LRUIPV run the same packed kernels as LRUIPVRP, LRU being the
+ *    IPV that moves every hit block and every new block to the MRU end.
+ *    Both fill invalid ways first, as LRURP does.
+ *  - TreePLRU keeps the same tree of bits as TreePLRURP and, like it, picks
+ *    its victim from the tree alone.
+ */
+class CacheReplay
+{
+    public:
+
+    enum Policy
+    {
+        LRU,
+        TreePLRU,
+        LRUIPV
+    };
+
+    /* Counts in the shape of the cache's stats.txt entries */
+    struct Stats
+    {
+        uint64_t hits = 0;              // overall_hits: demand and prefetch accesses that hit
+        uint64_t misses = 0;            // overall_misses: demand and prefetch accesses that missed
+        uint64_t replacements = 0;      // Valid blocks evicted by any fill, writebacks included
+    };
+
+    /**
+     * @return Why a geometry cannot be modelled, empty if it can.
+     */
+    static std::string
+    validConfig(uint64_t size, unsigned assoc, unsigned blkSize, Policy policy,
+                const std::vector<int> &ipv)
+    {
+        if (!isPowerOf2(blkSize)) {
+            return "block size is not a power of 2";
+        }
+        if (assoc < 1 || assoc > LRUIPVKernel::maxWays) {
+            return "associativity out of range";
+        }
+        if (size % (uint64_t(assoc) * blkSize) ||
+            !isPowerOf2(size / (uint64_t(assoc) * blkSize))) {
+            return "number of sets is not a power of 2";
+        }
+        if (policy == TreePLRU && (!isPowerOf2(assoc) || assoc > 64)) {
+            return "TreePLRU needs a power of 2 associativity up to 64";
+        }
+        if (policy == LRUIPV) {
+            if (ipv.size() != assoc + 1) {
+                return "IPV does not have associativity + 1 entries";
+            }
+            for (int position : ipv) {
+                if (position < 0 || position >= (int)assoc) {
+                    return "IPV entry is not a position of the set";
+                }
+            }
+        }
+        return "";
+    }
+
+    /**
+     * @param size Capacity in bytes.
+     * @param assoc Set associativity.
+     * @param blkSize Block size in bytes.
+     * @param policy Replacement policy.
+     * @param ipv Insertion and promotion vector, only used by LRUIPV.
+     */
+    CacheReplay(uint64_t size, unsigned assoc, unsigned blkSize, Policy policy,
+                const std::vector<int> &ipv = std::vector<int>())
+        : assoc(assoc), numSets(size / (uint64_t(assoc) * blkSize)),
+          blkShift(__builtin_ctz(blkSize)), policy(policy),
+          ipv(policy == LRUIPV ? ipv : std::vector<int>(assoc + 1, 0)),
+          setWords(policy == TreePLRU ? 1 :
+                   LRUIPVKernel::positionWords(assoc) + LRUIPVKernel::validWords(assoc)),
+          tags(numSets * assoc, invalidTag), state(numSets * setWords, 0)
+    {
+        if (policy != TreePLRU) {
+            LRUIPVKernel::dispatch(assoc, [&](const auto &kernel) {
+                for (uint64_t set = 0; set < numSets; set++) {
+                    kernel.init(&state[set * setWords]);
+                }
+            });
+        }
+    }
+
+    /**
+     * Replays a run of trace records against the cache. Reads, writes and
+     * prefetches are counted and allocate on a miss, writebacks allocate
+     * without being counted and clean evictions only touch a block that is
+     * already present, as in the cache's own stats. Fill records are the
+     * recording cache's business and are skipped.
+     */
+    void
+    replay(const AccessTrace::Record *records, size_t count, Stats &stats)
+    {
+        if (policy == TreePLRU) {
+            replay(PLRUTree{assoc}, records, count, stats);
+            return;
+        }
+        LRUIPVKernel::dispatch(assoc, [&](const auto &kernel) {
+            this->replay(kernel, records, count, stats);
+        });
+    }
+
+    const unsigned assoc;
+    const uint64_t numSets;
+
+    private:
+
+    static const uint64_t invalidTag = ~uint64_t(0);
+
+    /**
+     * TreePLRURP's tree, one bit per node in a word per set. Node i has
+     * children 2i+1 and 2i+2, a set bit points to the right subtree, and
+     * the leaves are the ways in order.
+     */
+    struct PLRUTree
+    {
+        unsigned ways;
+
+        /* Points every node on the way's path away from it */
+        void
+        touch(uint64_t &tree, unsigned way) const
+        {
+            unsigned node = way + ways - 1;
+            while (node) {
+                unsigned parent = (node - 1) / 2;
+                bool right = node == 2 * parent + 2;
+                tree = (tree & ~(uint64_t(1) << parent)) | (uint64_t(!right) << parent);
+                node = parent;
+            }
+        }
+
+        /* Follows the bits from the root down to a leaf */
+        unsigned
+        victim(uint64_t tree) const
+        {
+            unsigned node = 0;
+            while (node < ways - 1) {
+                node = 2 * node + 1 + ((tree >> node) & 1);
+            }
+            return node - (ways - 1);
+        }
+    };
+
+    static bool isPowerOf2(uint64_t n) { return n && !(n & (n - 1)); }
+
+    /**
+     * @return The way holding a block in a set, assoc if it is not there.
+     */
+    unsigned
+    findWay(const uint64_t *setTags, uint64_t blk) const
+    {
+        for (unsigned way = 0; way < assoc; way++) {
+            if (setTags[way] == blk) {
+                return way;
+            }
+        }
+        return assoc;
+    }
+
+    void hit(const PLRUTree &tree, uint64_t *set, unsigned way) { tree.touch(*set, way); }
+    unsigned victim(const PLRUTree &tree, const uint64_t *set) { return tree.victim(*set); }
+    void fill(const PLRUTree &tree, uint64_t *set, unsigned way) { tree.touch(*set, way); }
+
+    template <class Kernel>
+    void
+    hit(const Kernel &kernel, uint64_t *set, unsigned way)
+    {
+        LRUIPVKernel::hit(kernel, set, way, ipv.data());
+    }
+
+    template <class Kernel>
+    unsigned
+    victim(const Kernel &kernel, const uint64_t *set)
+    {
+        return kernel.victim(set);
+    }
+
+    template <class Kernel>
+    void
+    fill(const Kernel &kernel, uint64_t *set, unsigned way)
+    {
+        LRUIPVKernel::insert(kernel, set, way, ipv[assoc]);
+    }
+
+    template <class Repl>
+    void
+    replay(const Repl &repl, const AccessTrace::Record *records, size_t count,
+           Stats &stats)
+    {
+        for (size_t i = 0; i < count; i++) {
+            const AccessTrace::Record &record = records[i];
+            if (record.event == AccessTrace::Fill) {
+                continue;
+            }
+            uint64_t blk = record.addr >> blkShift;
+            uint64_t setIndex = blk & (numSets - 1);
+            uint64_t *setTags = &tags[setIndex * assoc];
+            uint64_t *set = &state[setIndex * setWords];
+            bool counted = record.type != AccessTrace::Writeback &&
+                           record.type != AccessTrace::CleanEvict;
+
+            unsigned way = findWay(setTags, blk);
+            if (way != assoc) {
+                hit(repl, set, way);
+                stats.hits += counted;
+                continue;
+            }
+            stats.misses += counted;
+            if (record.type == AccessTrace::CleanEvict) {
+                continue;
+            }
+            way = victim(repl, set);
+            stats.replacements += setTags[way] != invalidTag;
+            setTags[way] = blk;
+            fill(repl, set, way);
+        }
+    }
+
+    const unsigned blkShift;
+    const Policy policy;
+    const std::vector<int> ipv;         // LRU runs as the all-zero IPV
+    const unsigned setWords;
+    std::vector<uint64_t> tags;         // Block address held by each way, invalidTag if none
+    std::vector<uint64_t> state;        // Replacement state, setWords words per set
+};
+
+#endif // __MEM_CACHE_REPLACEMENT_POLICIES_CACHE_REPLAY_HH__
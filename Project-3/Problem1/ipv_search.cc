@@ -0,0 +1,264 @@
+/**
+ * Genetic search for LRUIPVRP insertion and promotion vectors over
+ * recorded cache access traces, after the LRU-IPV paper.
+ *
+ * Record traces with an AccessTraceProbe on the cache to tune, see
+ * cache_replay.cc, and build the tool from the root of the gem5 tree:
+ *     g++ -O3 -std=c++14 -pthread -Isrc util/ipv_search.cc \
+ *         -o ipv_search
+ *
+ * Usage:
+ *     ipv_search [-j threads] [-s size] [-a assoc] [-b block size]
+ *                [-n population] [-g generations] [-m mutation rate]
+ *                [-r seed] trace...
+ *
+ * The fitness of a vector is its mean miss rate over the traces, every
+ * workload weighing the same whatever its length. Each generation keeps
+ * the best vectors unchanged and breeds the rest from parents picked by
+ * tournament, with one-point crossover and per-entry mutation. The first
+ * generation holds LRU, the default IPV of LRUIPVRP when it fits the
+ * associativity and random vectors.
+ *
+ * Progress goes to stderr. The best vector is printed last, as a line that
+ * can be pasted into a configuration script.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mem/cache/replacement_policies/access_trace.hh"
+#include "mem/cache/replacement_policies/cache_replay.hh"
+
+namespace
+{
+
+typedef std::vector<int> IPV;
+
+/* Default IPV of LRUIPVRP */
+const IPV defaultIPV = {0, 0, 1, 0, 3, 0, 1, 2, 1, 0, 5, 1, 0, 0, 1, 11, 13};
+
+/* Parents are the best of this many random picks */
+const unsigned tournamentSize = 4;
+
+struct Search
+{
+    uint64_t size;
+    unsigned assoc;
+    unsigned blkSize;
+    unsigned threads;
+    const std::vector<AccessTrace::Reader> *traces;
+    std::map<IPV, double> fitness;      // Mean miss rate of every vector evaluated so far
+};
+
+/**
+ * Evaluates the vectors not seen before, every (vector, trace) pair being
+ * an independent job that workers pull until none is left.
+ */
+void
+evaluate(Search &search, const std::vector<IPV> &population)
+{
+    std::vector<IPV> pending;
+    for (const IPV &ipv : population) {
+        if (!search.fitness.count(ipv) &&
+            std::find(pending.begin(), pending.end(), ipv) == pending.end()) {
+            pending.push_back(ipv);
+        }
+    }
+    const std::vector<AccessTrace::Reader> &traces = *search.traces;
+    size_t jobs = pending.size() * traces.size();
+    std::vector<double> missRates(jobs);
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < std::min<size_t>(search.threads, jobs); w++) {
+        workers.emplace_back([&]() {
+            for (size_t job = next++; job < jobs; job = next++) {
+                const AccessTrace::Reader &trace = traces[job % traces.size()];
+                CacheReplay cache(search.size, search.assoc, search.blkSize,
+                                  CacheReplay::LRUIPV,
+                                  pending[job / traces.size()]);
+                CacheReplay::Stats stats;
+                cache.replay(trace.records(), trace.size(), stats);
+                uint64_t accesses = stats.hits + stats.misses;
+                missRates[job] = accesses ? double(stats.misses) / accesses : 0.0;
+            }
+        });
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    for (size_t v = 0; v < pending.size(); v++) {
+        double sum = 0.0;
+        for (size_t t = 0; t < traces.size(); t++) {
+            sum += missRates[v * traces.size() + t];
+        }
+        search.fitness[pending[v]] = sum / traces.size();
+    }
+}
+
+const IPV &
+tournament(const Search &search, const std::vector<IPV> &population,
+           std::mt19937_64 &rng)
+{
+    std::uniform_int_distribution<size_t> pick(0, population.size() - 1);
+    const IPV *best = &population[pick(rng)];
+    for (unsigned i = 1; i < tournamentSize; i++) {
+        const IPV *other = &population[pick(rng)];
+        if (search.fitness.at(*other) < search.fitness.at(*best)) {
+            best = other;
+        }
+    }
+    return *best;
+}
+
+std::string
+format(const IPV &ipv)
+{
+    std::string text;
+    for (size_t i = 0; i < ipv.size(); i++) {
+        text += (i ? ", " : "") + std::to_string(ipv[i]);
+    }
+    return text;
+}
+
+void
+usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-j threads] [-s size] [-a assoc] "
+            "[-b block size] [-n population] [-g generations] "
+            "[-m mutation rate] [-r seed] trace...\n", name);
+    exit(1);
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char **argv)
+{
+    Search search;
+    search.size = 1048576;
+    search.assoc = 16;
+    search.blkSize = 0;
+    search.threads = std::max(1u, std::thread::hardware_concurrency());
+    unsigned populationSize = 64;
+    unsigned generations = 50;
+    double mutationRate = 0.05;
+    uint64_t seed = 1;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg[0] != '-') {
+            paths.push_back(arg);
+            continue;
+        }
+        if (i + 1 == argc) {
+            usage(argv[0]);
+        }
+        if (arg == "-j") {
+            search.threads = std::max(1ul, std::stoul(argv[++i]));
+        } else if (arg == "-s") {
+            search.size = std::stoull(argv[++i]);
+        } else if (arg == "-a") {
+            search.assoc = std::stoul(argv[++i]);
+        } else if (arg == "-b") {
+            search.blkSize = std::stoul(argv[++i]);
+        } else if (arg == "-n") {
+            populationSize = std::max(2ul, std::stoul(argv[++i]));
+        } else if (arg == "-g") {
+            generations = std::stoul(argv[++i]);
+        } else if (arg == "-m") {
+            mutationRate = std::stod(argv[++i]);
+        } else if (arg == "-r") {
+            seed = std::stoull(argv[++i]);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (paths.empty()) {
+        usage(argv[0]);
+    }
+
+    std::vector<AccessTrace::Reader> traces(paths.size());
+    for (size_t t = 0; t < paths.size(); t++) {
+        std::string error = traces[t].open(paths[t]);
+        if (!error.empty()) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        if (!search.blkSize) {
+            search.blkSize = traces[t].header().blkSize;
+        }
+    }
+    search.traces = &traces;
+
+    IPV lru(search.assoc + 1, 0);
+    std::string error = CacheReplay::validConfig(search.size, search.assoc,
+                                                 search.blkSize,
+                                                 CacheReplay::LRUIPV, lru);
+    if (!error.empty()) {
+        fprintf(stderr, "size=%lu assoc=%u: %s\n",
+                (unsigned long)search.size, search.assoc, error.c_str());
+        return 1;
+    }
+
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int> position(0, search.assoc - 1);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    unsigned elites = std::max(1u, populationSize / 8);
+
+    std::vector<IPV> population = {lru};
+    if (defaultIPV.size() == search.assoc + 1) {
+        population.push_back(defaultIPV);
+    }
+    while (population.size() < populationSize) {
+        IPV ipv(search.assoc + 1);
+        for (int &entry : ipv) {
+            entry = position(rng);
+        }
+        population.push_back(ipv);
+    }
+
+    for (unsigned generation = 0; ; generation++) {
+        evaluate(search, population);
+        std::sort(population.begin(), population.end(),
+                  [&](const IPV &a, const IPV &b) {
+                      return search.fitness.at(a) < search.fitness.at(b);
+                  });
+        fprintf(stderr, "generation %u: best %.6f lru %.6f [%s]\n",
+                generation, search.fitness.at(population[0]),
+                search.fitness.at(lru), format(population[0]).c_str());
+        if (generation == generations) {
+            break;
+        }
+
+        std::vector<IPV> offspring(population.begin(),
+                                   population.begin() + elites);
+        while (offspring.size() < populationSize) {
+            const IPV &mother = tournament(search, population, rng);
+            const IPV &father = tournament(search, population, rng);
+            size_t cut = std::uniform_int_distribution<size_t>(
+                1, search.assoc)(rng);
+            IPV child(mother.begin(), mother.begin() + cut);
+            child.insert(child.end(), father.begin() + cut, father.end());
+            for (int &entry : child) {
+                if (chance(rng) < mutationRate) {
+                    entry = position(rng);
+                }
+            }
+            offspring.push_back(child);
+        }
+        population.swap(offspring);
+    }
+
+    printf("# mean overall_miss_rate %.6f, LRU %.6f\n",
+           search.fitness.at(population[0]), search.fitness.at(lru));
+    printf("ipv=[%s]\n", format(population[0]).c_str());
+    return 0;
+}
@@ -1,69 +1,379 @@
 #include "mem/cache/replacement_policies/lru_ipv.hh"
 
+#include <algorithm>
 #include <cassert>
 #include <memory>
+#include <numeric>
 
 #include "params/LRUIPVRP.hh"
+#include "base/output.hh"
+#include "mem/cache/cache_blk.hh"
 #include "sim/core.hh"
+#include "sim/system.hh"
 #include "debug/LRUIPVDebug.hh"
 #include "base/trace.hh"
 
 /* Constructor for LRUIPVReplData structure */
-LRUIPVRP::LRUIPVReplData::LRUIPVReplData(int blockIndex,std::shared_ptr<std::vector<int>> position):blockIndex(blockIndex), position(position) {}
+LRUIPVRP::LRUIPVReplData::LRUIPVReplData(uint32_t set, uint32_t way):set(set), way(way), prefetched(false), blk(nullptr),
+    signature(0), predictedDead(false), reused(false), shipSampled(false), owner(-1) {}
+
+namespace
+{
+
+/* IPV tuned for the 16-way L2 of Project 3 */
+const std::vector<int> defaultIPV = {0, 0, 1, 0, 3, 0, 1, 2, 1, 0, 5, 1, 0, 0, 1, 11, 13};
+
+/**
+ * @return The IPVs given as parameter, or without any the tuned IPV on a
+ * 16-way cache and an IPV that behaves like LRU on other associativities.
+ */
+std::vector<int>
+ipvsOf(const LRUIPVRPParams *p)
+{
+    if (!p->ipv.empty()) {
+        return p->ipv;
+    }
+    if (p->assoc == 16) {
+        return defaultIPV;
+    }
+    return std::vector<int>(p->assoc + 1, 0); // Hits and fills go to the most recent position
+}
+
+/**
+ * Checks the geometry of the IPVs and the set dueling. Called first in the
+ * constructor's initializer list, before the stats are sized with them.
+ * @return The parameters.
+ */
+const LRUIPVRPParams *
+checkedParams(const LRUIPVRPParams *p)
+{
+    fatal_if(p->assoc < 1 || (unsigned)p->assoc > LRUIPVKernel::maxWays,
+             "LRUIPVRP supports 1 to %d ways, got %d\n", LRUIPVKernel::maxWays, p->assoc);
+    /* One new position per position a block can be hit at, plus the insertion position, for every IPV */
+    fatal_if(p->ipv.size() % (p->assoc + 1),
+             "LRUIPVRP: the IPVs of a %d-way cache need %d entries each, got %d entries\n",
+             p->assoc, p->assoc + 1, p->ipv.size());
+    for (int position : p->ipv) {
+        fatal_if(position < 0 || position >= p->assoc,
+                 "LRUIPVRP: IPV entry %d is not a position of a %d-way set\n", position, p->assoc);
+    }
+    /* Every period of sets needs a leader set for each IPV and followers */
+    unsigned numVectors = std::max<size_t>(p->ipv.size() / (p->assoc + 1), 1);
+    fatal_if(numVectors > 1 && p->leaderSetPeriod <= numVectors,
+             "LRUIPVRP: a leader set period of %d leaves no follower sets for %d IPVs\n",
+             p->leaderSetPeriod, numVectors);
+    fatal_if(p->pselBits < 1 || p->pselBits > 31, "LRUIPVRP: invalid PSEL bits %d\n", p->pselBits);
+    return p;
+}
+
+} // anonymous namespace
 
 /* Constructor for class LRUIPVRP */
 LRUIPVRP::LRUIPVRP(const Params *p)
-    : BaseReplacementPolicy(p), blockCount(0), ptr_LRUIPVCache(nullptr)
+    : BaseReplacementPolicy(p), blockCount(0), associativity(checkedParams(p)->assoc),
+      IPV_Graph(ipvsOf(p)),
+      numVectors(IPV_Graph.size() / (associativity + 1)),
+      leaderSetPeriod(p->leaderSetPeriod),
+      missCounterMax((1u << p->pselBits) - 1),
+      setWords(LRUIPVKernel::positionWords(p->assoc) + LRUIPVKernel::validWords(p->assoc)),
+      missCounters(numVectors, 0), winner(0),
+      stats(this, numVectors),
+      reuseSamplePeriod(p->reuseSamplePeriod),
+      reuseDistanceMax(p->reuseDistanceMax),
+      profile(this, p->assoc, p->reuseDistanceMax),
+      system(p->system),
+      prefetcherName(p->prefetcherName),
+      prefetchInsertPosition(p->prefetchInsertPosition),
+      prefetchHitPosition(p->prefetchHitPosition),
+      victimSet(unbound), victimWay(0), victimTag(0), victimValid(false),
+      prefetchStats(this),
+      shctEntries(p->shctEntries),
+      shctMax((1u << p->shctBits) - 1),
+      regionBits(p->signatureRegionBits),
+      shipSamplePeriod(p->shipSamplePeriod),
+      shipStats(this),
+      owners(p->partitionOwners),
+      numOwners(owners.size()),
+      partitionPeriod(p->partitionPeriod),
+      umonSamplePeriod(p->umonSamplePeriod),
+      fillsSincePartition(0),
+      partitionWays(numOwners, 0),
+      utilityHits(numOwners * p->assoc, 0),
+      partitionStats(this, owners)
 {
+    fatal_if(reuseSamplePeriod && reuseDistanceMax == 0,
+             "LRUIPVRP: profiling reuse distances needs a reuseDistanceMax\n");
+    fatal_if(prefetchInsertPosition < -1 || prefetchInsertPosition >= (int)associativity ||
+             prefetchHitPosition < -1 || prefetchHitPosition >= (int)associativity,
+             "LRUIPVRP: prefetch positions must be -1 or a position of a %d-way set\n", associativity);
+    fatal_if(shctEntries & (shctEntries - 1),
+             "LRUIPVRP: %d signature history counters is not a power of 2\n", shctEntries);
+    fatal_if(shctEntries && (p->shctBits < 1 || p->shctBits > 8 || shipSamplePeriod == 0 || regionBits > 32),
+             "LRUIPVRP: invalid signature history counter bits, training set period or region bits\n");
+    shct.assign(shctEntries, (shctMax + 1) / 2); // Weakly reused, fills are inserted with the IPV until trained
+    fatal_if(partitionPeriod && (numOwners < 1 || numOwners > associativity || umonSamplePeriod == 0),
+             "LRUIPVRP: partitioning needs 1 to %d owners and a utility monitor set period\n", associativity);
+    for (unsigned owner = 0; owner < numOwners; owner++) {
+        partitionWays[owner] = associativity / numOwners + (owner < associativity % numOwners); // Even split until the monitors have seen enough
+        partitionStats.ownerWays[owner] = partitionWays[owner];
+    }
+    /* Binary trace of the policy's events, cheap enough for whole runs */
+    fatal_if(!p->eventTrace.empty() &&
+             !eventTrace.open(simout.resolve(p->eventTrace), name(), p->eventTraceRing),
+             "Cannot create LRUIPVRP event trace %s\n", p->eventTrace);
 }
 
-/* The functionality of invalidate is provided in getVictim() */
-void LRUIPVRP::invalidate(const std::shared_ptr<ReplacementData>& replacement_data) const
+/* Constructor for the set dueling stats */
+LRUIPVRP::DuelingStats::DuelingStats(Stats::Group *parent, unsigned vectors)
+    : Stats::Group(parent),
+      ADD_STAT(leaderMisses, "Misses in the leader sets of each IPV"),
+      ADD_STAT(followerInsertions, "Blocks inserted in follower sets with each IPV"),
+      ADD_STAT(switches, "Number of times the follower sets switched IPV")
 {
+    leaderMisses.init(vectors);
+    followerInsertions.init(vectors);
+    for (unsigned vector = 0; vector < vectors; vector++) {
+        leaderMisses.subname(vector, "ipv" + std::to_string(vector));
+        followerInsertions.subname(vector, "ipv" + std::to_string(vector));
+    }
+}
+
+/* Constructor for the recency position and reuse distance profile */
+LRUIPVRP::ProfileStats::ProfileStats(Stats::Group *parent, unsigned ways, unsigned reuseDistanceMax)
+    : Stats::Group(parent),
+      ADD_STAT(hitPositions, "Hits at each recency position, 0 is the MRU end"),
+      ADD_STAT(insertPositions, "Blocks inserted at each recency position"),
+      ADD_STAT(victimPositions, "Valid victims evicted from each recency position"),
+      ADD_STAT(invalidVictims, "Victims picked because their way was invalid"),
+      ADD_STAT(reuseDistance, "Distinct blocks accessed in a sampled set between two accesses to the same block, overflows are first accesses and deeper reuses")
+{
+    hitPositions.init(ways).flags(Stats::total | Stats::pdf);
+    insertPositions.init(ways).flags(Stats::total | Stats::pdf);
+    victimPositions.init(ways).flags(Stats::total | Stats::pdf);
+    reuseDistance.init(0, std::max(reuseDistanceMax, 1u) - 1, 1).flags(Stats::pdf);
+}
+
+/* Constructor for the prefetch stats */
+LRUIPVRP::PrefetchStats::PrefetchStats(Stats::Group *parent)
+    : Stats::Group(parent),
+      ADD_STAT(prefetchFills, "Blocks filled by a prefetcher"),
+      ADD_STAT(usefulPrefetches, "Prefetched blocks hit before leaving the cache"),
+      ADD_STAT(uselessPrefetches, "Prefetched blocks evicted or invalidated without a hit"),
+      ADD_STAT(prefetchEvictions, "Valid blocks evicted to make room for a prefetched block"),
+      ADD_STAT(pollutionMisses, "Demand fills of a block a prefetch fill had evicted"),
+      ADD_STAT(prefetchAccuracy, "Fraction of the prefetched blocks that were hit")
+{
+    prefetchAccuracy = usefulPrefetches / prefetchFills;
+}
+
+/* Constructor for the dead block prediction stats */
+LRUIPVRP::ShipStats::ShipStats(Stats::Group *parent)
+    : Stats::Group(parent),
+      ADD_STAT(predictedDead, "Fills whose signature predicted no reuse"),
+      ADD_STAT(deadInsertions, "Fills predicted dead and inserted at the LRU end"),
+      ADD_STAT(correctDead, "Training set blocks predicted dead and never reused"),
+      ADD_STAT(wrongDead, "Training set blocks predicted dead but reused"),
+      ADD_STAT(correctLive, "Training set blocks predicted live and reused"),
+      ADD_STAT(wrongLive, "Training set blocks predicted live but never reused"),
+      ADD_STAT(predictionAccuracy, "Fraction of the training set blocks whose reuse was predicted right")
+{
+    predictionAccuracy = (correctDead + correctLive) /
+        (correctDead + wrongDead + correctLive + wrongLive);
+}
+
+/* Constructor for the per owner stats */
+LRUIPVRP::PartitionStats::PartitionStats(Stats::Group *parent, const std::vector<std::string> &owners)
+    : Stats::Group(parent),
+      ADD_STAT(ownerHits, "Hits per owner of the block"),
+      ADD_STAT(ownerMisses, "Blocks filled per owner"),
+      ADD_STAT(ownerOccupancy, "Valid blocks per owner, averaged over time"),
+      ADD_STAT(ownerWays, "Ways allocated per owner, averaged over time"),
+      ADD_STAT(repartitions, "Number of times the ways were allocated anew")
+{
+    ownerHits.init(owners.size() + 1).flags(Stats::total);
+    ownerMisses.init(owners.size() + 1).flags(Stats::total);
+    ownerOccupancy.init(owners.size() + 1);
+    ownerWays.init(owners.size() + 1);
+    for (size_t owner = 0; owner <= owners.size(); owner++) {
+        std::string name = owner < owners.size() ? owners[owner] : "other";
+        std::replace(name.begin(), name.end(), '.', '_');   // Stat names cannot hold dots
+        ownerHits.subname(owner, name);
+        ownerMisses.subname(owner, name);
+        ownerOccupancy.subname(owner, name);
+        ownerWays.subname(owner, name);
+    }
+}
+
+void
+LRUIPVRP::invalidate(const std::shared_ptr<ReplacementData>& replacement_data) const
+{
+    LRUIPVReplData *replacementData = static_cast<LRUIPVReplData*>(replacement_data.get()); // Get pointer to block data's structure without touching its reference count
+    assert(replacementData->set != unbound);
+    uint64_t *set = setState(replacementData->set); // Get the packed state of the block's set
+    LRUIPVKernel::dispatch(associativity, [&](const auto &kernel) {
+        LRUIPVKernel::invalidate(kernel, set, replacementData->way); // The block is no longer valid, getVictim() picks it before any valid block
+    });
+    if(replacementData->prefetched)  // Leaves the cache without ever being hit
+    {
+        prefetchStats.uselessPrefetches++;
+        replacementData->prefetched = false;
+    }
+    shipRetire(replacementData);
+    if(replacementData->owner >= 0)
+    {
+        partitionStats.ownerOccupancy[replacementData->owner]--;
+        replacementData->owner = -1;
+    }
+    if(eventTrace.isOpen())
+    {
+        eventTrace.append(EventTrace::LRUIPVInvalidate, 0, replacementData->set, replacementData->way);
+    }
 }
 
 void
 LRUIPVRP::touch(const std::shared_ptr<ReplacementData>& replacement_data) const
 {
-    std::shared_ptr<LRUIPVReplData> replacementData = std::static_pointer_cast<LRUIPVReplData>(replacement_data); // Get pointer to block data's structure
-    std::vector<int> *ptr = replacementData->position.get(); // Get pointer to vector containing infromation about positions of each blocks
-    int position = IPV_Graph[replacementData->blockIndex]; // Get new position from IPV graph using block index stored in the structure
-    int old = ptr->at(replacementData->blockIndex); // Get the current position of the block from the vector containing infromation about positions of each block
-    DPRINTF(LRUIPVDebug,"[block index %d] position:%d \t new position %d \n",replacementData->blockIndex,old,position);
-    ptr->at(replacementData->blockIndex) = position; // Update the position of the block in the vector containing information about positions of each block
-    int vectorSize = ptr->size(); // Get the vector size to iterate over and shift the positions of the block by 1 wherever necessary
-    int index=0;
-
-    while(index < vectorSize) // Iterate till the end of the vector
-    {
-        if((ptr->at(index) >= position) && (ptr->at(index) < old)) // Need to update the position of blocks between new position and old position of the block calling touch
-        {   
-            
-            ptr->at(index) = ptr->at(index) + 1; // Move the position of blocks right by 1
-        }
-        index++;
+    LRUIPVReplData *replacementData = static_cast<LRUIPVReplData*>(replacement_data.get()); // Get pointer to block data's structure without touching its reference count
+    assert(replacementData->set != unbound);
+    uint64_t *set = setState(replacementData->set); // Get the packed state of the block's set
+    const int *graph = ipv(vectorOf(replacementData->set)); // IPV the set runs with
+    bool firstPrefetchHit = replacementData->prefetched;
+    if(firstPrefetchHit)  // The prefetch paid off
+    {
+        prefetchStats.usefulPrefetches++;
+        replacementData->prefetched = false;
     }
+    if(replacementData->shipSampled && !replacementData->reused)  // First reuse of a training set block
+    {
+        uint8_t &counter = shct[replacementData->signature];
+        counter += counter < shctMax;
+    }
+    replacementData->reused = true;
+    if(replacementData->owner >= 0)
+    {
+        partitionStats.ownerHits[replacementData->owner]++;
+        sampleUtility(replacementData);
+    }
+    LRUIPVKernel::dispatch(associativity, [&](const auto &kernel) {
+        unsigned position = kernel.position(set, replacementData->way);
+        unsigned newPosition = firstPrefetchHit && prefetchHitPosition >= 0 ?
+            prefetchHitPosition : graph[position];
+        DPRINTF(LRUIPVDebug,"[set %d way %d] position:%d \t new position %d \n",replacementData->set,replacementData->way,
+                position,newPosition);
+        profile.hitPositions[position]++;
+        if(eventTrace.isOpen())
+        {
+            eventTrace.append(EventTrace::LRUIPVTouch, 0, replacementData->set, replacementData->way,
+                              position << 8 | newPosition);
+        }
+        kernel.move(set, replacementData->way, newPosition); // Move the block to its new position, blocks in between shift by 1
+    });
+    sampleReuse(replacementData);
 }   
 
 void
 LRUIPVRP::reset(const std::shared_ptr<ReplacementData>& replacement_data) const
 {
-    std::shared_ptr<LRUIPVReplData> replacementData = std::static_pointer_cast<LRUIPVReplData>(replacement_data); // Get pointer to block data's structure
-    std::vector<int> *ptr = replacementData->position.get(); // Get pointer to vector containing infromation about positions of each blocks
-    int vectorSize = ptr->size(); // Get the vector size to iterate over and shift the positions of the block by 1 wherever necessary
-    int index=0;
-
-    while(index  < vectorSize)  // Iterate till the end of the vector
-    {   
-        // The position of blocks >= 13 needs to be shifted by 1 
-        if((ptr->at(index) >= IPV_Graph[associativity]) && (ptr->at(index) != -1)) // Each block will contain -1 as it's initial positon when initialized. To avoid shifting these blocks, index != -1 condition is placed 
+    LRUIPVReplData *replacementData = static_cast<LRUIPVReplData*>(replacement_data.get()); // Get pointer to block data's structure without touching its reference count
+    assert(replacementData->set != unbound);
+    uint64_t *set = setState(replacementData->set); // Get the packed state of the block's set
+    unsigned vector = vectorOf(replacementData->set); // IPV the set runs with
+    if(replacementData->prefetched)  // The block it replaces was prefetched and never hit
+    {
+        prefetchStats.uselessPrefetches++;
+    }
+    shipRetire(replacementData);    // A replaced block ends its life here if it was not invalidated first
+    if(replacementData->owner >= 0)
+    {
+        partitionStats.ownerOccupancy[replacementData->owner]--;
+        replacementData->owner = -1;
+    }
+    const CacheBlk *blk = replacementData->blk;
+    const RequestorInfo *info = blk ? &requestorInfo(blk->srcRequestorId) : nullptr; // The cache has set the new block's tag and requestor already
+    bool prefetch = info && info->prefetcher;
+    if(numOwners && info)
+    {
+        replacementData->owner = info->owner;
+        partitionStats.ownerOccupancy[info->owner]++;
+        partitionStats.ownerMisses[info->owner]++;
+        sampleUtility(replacementData);
+        if(partitionPeriod && ++fillsSincePartition == partitionPeriod)
+        {
+            partition();
+        }
+    }
+    replacementData->prefetched = prefetch;
+    bool evicted = victimValid && victimSet == replacementData->set && victimWay == replacementData->way;
+    victimSet = unbound;    // The victim is consumed by this fill
+    if(prefetch)
+    {
+        prefetchStats.prefetchFills++;
+        if (evicted) {
+            prefetchStats.prefetchEvictions++;
+            prefetchEvicted.resize(std::max<size_t>(prefetchEvicted.size(), sets.size() / setWords * associativity), MaxAddr);
+            prefetchEvicted[replacementData->set * associativity + replacementData->way] = victimTag;
+        }
+    }
+    else if(blk && replacementData->set * associativity < prefetchEvicted.size())  // Look for the block among the ones prefetches pushed out
+    {
+        Addr *evictedTags = &prefetchEvicted[replacementData->set * associativity];
+        for (unsigned way = 0; way < associativity; way++) {
+            if (evictedTags[way] == blk->tag) {
+                prefetchStats.pollutionMisses++;
+                evictedTags[way] = MaxAddr;
+                break;
+            }
+        }
+    }
+    if(numVectors > 1 && !prefetch)  // Every demand insertion follows a miss
+    {
+        if(replacementData->set % leaderSetPeriod < numVectors) {
+            leaderMiss(vector);
+        } else {
+            stats.followerInsertions[vector]++;
+        }
+    }
+    int position = ipv(vector)[associativity];
+    // Owners insert as far from the LRU end as they have ways, except in
+    // leader sets so the duel still compares the IPVs
+    bool leader = numVectors > 1 && replacementData->set % leaderSetPeriod < numVectors;
+    if(partitionPeriod && replacementData->owner >= 0 && (unsigned)replacementData->owner < numOwners && !leader)
+    {
+        position = associativity - partitionWays[replacementData->owner];
+    }
+    if(prefetch && prefetchInsertPosition >= 0)
+    {
+        position = prefetchInsertPosition;
+    }
+    replacementData->reused = false;
+    if(shctEntries && blk)  // Predict whether the new block will be reused
+    {
+        replacementData->signature = signatureOf(replacementData);
+        replacementData->predictedDead = shct[replacementData->signature] == 0;
+        // Training sets keep inserting with the IPV, so the outcomes they
+        // learn from do not depend on the predictions
+        replacementData->shipSampled = replacementData->set % shipSamplePeriod == 0;
+        if(replacementData->predictedDead)
         {
-            DPRINTF(LRUIPVDebug,"block # shifted by 1:%d\n",ptr->at(index));
-            ptr->at(index) = ptr->at(index) + 1;
+            shipStats.predictedDead++;
+            if(!replacementData->shipSampled && !(prefetch && prefetchInsertPosition >= 0))
+            {
+                shipStats.deadInsertions++;
+                position = associativity - 1;
+            }
         }
-        index++;
     }
-    ptr->at(replacementData->blockIndex) = IPV_Graph[associativity]; // Assign 13 as position to the block calling reset
+    LRUIPVKernel::dispatch(associativity, [&](const auto &kernel) {
+        LRUIPVKernel::insert(kernel, set, replacementData->way, position); // Insert the block at the insertion position of the IPV
+    });
+    profile.insertPositions[position]++;
+    sampleReuse(replacementData);
+    DPRINTF(LRUIPVDebug,"[set %d way %d] inserted at %d with ipv%d\n",replacementData->set,replacementData->way,position,vector);
+    if(eventTrace.isOpen())
+    {
+        eventTrace.append(EventTrace::LRUIPVReset, 0, replacementData->set, replacementData->way,
+                          position << 8 | vector);
+    }
 }
 
 ReplaceableEntry*
@@ -71,41 +381,332 @@ LRUIPVRP::getVictim(const ReplacementCandidates& candidates) const
 {
     // There must be at least one replacement candidate
     assert(candidates.size() > 0);
-    DPRINTF(LRUIPVDebug,"LRUIPVRP::getVictim \n");
-    std::shared_ptr<LRUIPVReplData> replacementData = std::static_pointer_cast<LRUIPVReplData>(candidates[0]->replacementData); // Get pointer to block data's structure
-    std::vector<int> *ptr = replacementData->position.get(); // Get pointer to vector containing infromation about positions of each blocks
-    int vectorSize = ptr->size(); // Get the vector size to iterate over and find the victim block's index
-    int index=0; // Variable to iterate over all the blocks
-    int victim=0;   // Variable to store the victim block's index
-    int maxPosition=0; // Variable to store and compare block's current position
+    const LRUIPVReplData *replacementData = static_cast<const LRUIPVReplData*>(candidates[0]->replacementData.get()); // Get pointer to block data's structure
+    if(replacementData->set == unbound)   // First time this set is looked at
+    {
+        bind(candidates);
+    }
+    const uint64_t *set = setState(replacementData->set);
+    bool valid = true;
+    unsigned victim = LRUIPVKernel::dispatch(associativity, [&](const auto &kernel) {
+        unsigned way = kernel.victim(set); // Invalid way first, otherwise the way at the LRU end
+        valid = kernel.isValid(set, way);
+        if (valid) {
+            profile.victimPositions[kernel.position(set, way)]++;
+        } else {
+            profile.invalidVictims++;
+        }
+        return way;
+    });
+    DPRINTF(LRUIPVDebug,"Victim:%d \n",victim);
+    const LRUIPVReplData *victimData = static_cast<const LRUIPVReplData*>(candidates[victim]->replacementData.get());
+    victimSet = victimData->set;    // Remembered for the fill that follows, prefetch fills record what they evict
+    victimWay = victim;
+    victimValid = valid && victimData->blk;
+    victimTag = victimValid ? victimData->blk->tag : 0;
+    if(eventTrace.isOpen())
+    {
+        eventTrace.append(EventTrace::LRUIPVVictim, 0, replacementData->set, victim, valid);
+    }
+    assert(candidates[victim]->getWay() == victim); // Candidates come in way order
+    return candidates[victim]; // Return the victim block
+}
 
-    while(index < vectorSize)
+void
+LRUIPVRP::leaderMiss(unsigned vector) const
+{
+    stats.leaderMisses[vector]++;
+    if(missCounters[vector] == missCounterMax)  // Age every counter to make room
+    {
+        for (unsigned &counter : missCounters) {
+            counter >>= 1;
+        }
+    }
+    missCounters[vector]++;
+    unsigned best = winner;
+    for (unsigned other = 0; other < numVectors; other++) {
+        if (missCounters[other] < missCounters[best]) {
+            best = other;
+        }
+    }
+    if(best != winner)  // Followers switch only when another IPV strictly misses less
     {
-        if(maxPosition < ptr->at(index))  // If the position is found to be greater, then that is our victim block
+        DPRINTF(LRUIPVDebug,"followers switch from ipv%d to ipv%d\n",winner,best);
+        stats.switches++;
+        winner = best;
+    }
+}
+
+void
+LRUIPVRP::bind(const ReplacementCandidates& candidates) const
+{
+    fatal_if(candidates.size() != associativity,
+             "LRUIPVRP: expected the %d ways of a set as candidates, got %d\n",
+             associativity, candidates.size());
+    for (ReplaceableEntry *candidate : candidates) {
+        LRUIPVReplData *data = static_cast<LRUIPVReplData*>(candidate->replacementData.get());
+        data->set = candidate->getSet();
+        data->way = candidate->getWay();
+        while (sets.size() < (data->set + 1) * setWords) // More sets than blocks were instantiated for
         {
-            maxPosition = ptr->at(index); // Store the position to be referenced again
-            victim = index; // Store the index of victim block's index
+            sets.resize(sets.size() + setWords);
+            LRUIPVKernel::dispatch(associativity, [&](const auto &kernel) {
+                kernel.init(&sets[sets.size() - setWords]);
+            });
         }
-        index++;
+        data->blk = dynamic_cast<const CacheBlk*>(candidate); // Tags and requestors are read from the block, null outside caches
+    }
+}
+
+const LRUIPVRP::RequestorInfo &
+LRUIPVRP::requestorInfo(RequestorID requestor) const
+{
+    if(requestor >= requestors.size())
+    {
+        requestors.resize(requestor + 1, RequestorInfo{false, false, 0});
+    }
+    RequestorInfo &info = requestors[requestor];
+    if(!info.known)   // First block from this requestor
+    {
+        std::string name = system ? system->getRequestorName(requestor) : "";
+        info.known = true;
+        info.prefetcher = system && name.find(prefetcherName) != std::string::npos;
+        info.owner = numOwners;
+        for (unsigned owner = 0; owner < numOwners; owner++) {
+            const std::string &prefix = owners[owner];
+            // system.cpu1 owns system.cpu1.data but not system.cpu10.data
+            if (name.compare(0, prefix.size(), prefix) == 0 &&
+                (name.size() == prefix.size() || name[prefix.size()] == '.')) {
+                info.owner = owner;
+                break;
+            }
+        }
+        DPRINTF(LRUIPVDebug,"requestor %d %s: owner %d prefetcher %d\n",requestor,name,info.owner,info.prefetcher);
+    }
+    return info;
+}
+
+uint32_t
+LRUIPVRP::signatureOf(const LRUIPVReplData *data) const
+{
+    // Blocks of a region are consecutive in the address space: the block
+    // number is the tag followed by the set index bits
+    uint64_t region = (data->blk->tag * (sets.size() / setWords) + data->set) >> regionBits;
+    uint64_t key = region ^ uint64_t(data->blk->srcRequestorId) << 48;
+    return uint32_t((key * 0x9E3779B97F4A7C15ULL) >> 32) & (shctEntries - 1);
+}
+
+void
+LRUIPVRP::shipRetire(LRUIPVReplData *data) const
+{
+    if(!data->shipSampled)
+    {
+        return;
+    }
+    data->shipSampled = false;
+    if(!data->reused)   // Left the cache unused, blocks of its signature are less likely to be reused
+    {
+        uint8_t &counter = shct[data->signature];
+        counter -= counter > 0;
+    }
+    if(data->predictedDead)
+    {
+        (data->reused ? shipStats.wrongDead : shipStats.correctDead)++;
+    }
+    else
+    {
+        (data->reused ? shipStats.correctLive : shipStats.wrongLive)++;
+    }
+}
+
+void
+LRUIPVRP::sampleUtility(const LRUIPVReplData *data) const
+{
+    if(!partitionPeriod || (unsigned)data->owner >= numOwners || data->set % umonSamplePeriod != 0)
+    {
+        return;
+    }
+    size_t stackIndex = data->set / umonSamplePeriod * numOwners + data->owner;
+    if(stackIndex >= umonStacks.size())
+    {
+        umonStacks.resize(stackIndex + 1);
+    }
+    std::vector<Addr> &stack = umonStacks[stackIndex];
+    auto found = std::find(stack.begin(), stack.end(), data->blk->tag);
+    if(found == stack.end())  // Would have missed even with the whole set
+    {
+        if (stack.size() == associativity) {
+            stack.pop_back();
+        }
+        stack.insert(stack.begin(), data->blk->tag);
+    }
+    else
+    {
+        utilityHits[data->owner * associativity + (found - stack.begin())]++;
+        std::rotate(stack.begin(), found, found + 1); // Back to the most recent end
+    }
+}
+
+void
+LRUIPVRP::partition() const
+{
+    fillsSincePartition = 0;
+    /* Hits an owner would have with its most recently used ways of a set */
+    auto utility = [&](unsigned owner, unsigned ways) {
+        const uint64_t *hits = &utilityHits[owner * associativity];
+        return std::accumulate(hits, hits + ways, uint64_t(0));
+    };
+    if (std::all_of(utilityHits.begin(), utilityHits.end(), [](uint64_t hits) { return hits == 0; })) {
+        return; // Cold or decayed monitors, no owner gains anything: keep the allocation
+    }
+    std::vector<unsigned> ways(numOwners, 1);
+    unsigned balance = associativity - numOwners;
+    while(balance > 0)
+    {
+        double bestGain = -1;
+        unsigned bestOwner = 0, bestWays = 1;
+        for (unsigned owner = 0; owner < numOwners; owner++) {
+            uint64_t base = utility(owner, ways[owner]);
+            for (unsigned more = 1; more <= balance; more++) { // Look ahead past flat stretches of the utility curve
+                double gain = double(utility(owner, ways[owner] + more) - base) / more;
+                if (gain > bestGain || (gain == bestGain && ways[owner] < ways[bestOwner])) { // Flat gains go to the smallest share
+                    bestGain = gain;
+                    bestOwner = owner;
+                    bestWays = more;
+                }
+            }
+        }
+        ways[bestOwner] += bestWays;
+        balance -= bestWays;
+    }
+    for (unsigned owner = 0; owner < numOwners; owner++) {
+        DPRINTF(LRUIPVDebug,"owner %s: %d ways, was %d\n",owners[owner],ways[owner],partitionWays[owner]);
+        partitionStats.ownerWays[owner] = ways[owner];
+    }
+    partitionWays = ways;
+    partitionStats.repartitions++;
+    for (uint64_t &hits : utilityHits) {
+        hits >>= 1; // Older behaviour weighs less
+    }
+}
+
+void
+LRUIPVRP::sampleReuse(const LRUIPVReplData *data) const
+{
+    if(!reuseSamplePeriod || data->set % reuseSamplePeriod != reuseSamplePeriod - 1 || !data->blk)
+    {
+        return;
+    }
+    size_t slot = data->set / reuseSamplePeriod;
+    if(slot >= reuseStacks.size())
+    {
+        reuseStacks.resize(slot + 1);
+    }
+    const CacheBlk *blk = data->blk;
+    std::vector<Addr> &stack = reuseStacks[slot];
+    auto found = std::find(stack.begin(), stack.end(), blk->tag);
+    if(found == stack.end())  // First access, or reused deeper than the stack goes
+    {
+        profile.reuseDistance.sample(reuseDistanceMax);
+        if (stack.size() == reuseDistanceMax) {
+            stack.pop_back();
+        }
+        stack.insert(stack.begin(), blk->tag);
+    }
+    else
+    {
+        profile.reuseDistance.sample(found - stack.begin());
+        std::rotate(stack.begin(), found, found + 1); // Back to the most recent end
     }
-    DPRINTF(LRUIPVDebug,"Victim:%d \n",victim);
-    return candidates[victim]; // Return the victim block
 }
 
 std::shared_ptr<ReplacementData>
 LRUIPVRP::instantiateEntry()
 {   
-    DPRINTF(LRUIPVDebug,"LRUIPVRP::instantiateEntry \n");
-    if(blockCount % associativity == 0)  // 16 blocks will be assigned to same vector 
+    if(blockCount % entriesPerChunk == 0)  // Replacement data is carved out of large contiguous chunks
     {
-        DPRINTF(LRUIPVDebug,"new vector created \n");
-        ptr_LRUIPVCache = new std::vector<int>(associativity,-1); // create new vector whenver multiples of 16 blocks are created
+        DPRINTF(LRUIPVDebug,"new chunk created \n");
+        chunk = std::make_shared<std::vector<LRUIPVReplData>>(entriesPerChunk);
     }
-    /* Initialize the structure containing information about block's data. Index is equated to number of blocks initialized + 1 */
-    LRUIPVReplData *data = new LRUIPVReplData(blockCount % associativity, std::shared_ptr<std::vector<int>>(ptr_LRUIPVCache)); // Same pointer to the vector containing information about each block is shared among the 16 blocks
+    if(blockCount % associativity == 0)  // Room for one more set every associativity blocks
+    {
+        sets.resize(sets.size() + setWords);
+        LRUIPVKernel::dispatch(associativity, [&](const auto &kernel) {
+            kernel.init(&sets[sets.size() - setWords]);
+        });
+    }
+    LRUIPVReplData &data = (*chunk)[blockCount % entriesPerChunk]; // Left unbound, getVictim() learns its set and way
     blockCount++; // Increase block count every time instantiate entry is invoked
-    DPRINTF(LRUIPVDebug,"blockCount:%d \n",blockCount);
-    return std::shared_ptr<ReplacementData>(data);
+    return std::shared_ptr<ReplacementData>(chunk, &data); // Shares the chunk's reference count, no allocation per block
+}
+
+void
+LRUIPVRP::serialize(CheckpointOut &cp) const
+{
+    unsigned associativity = this->associativity; // Checked on restore, the packed layout depends on it
+    SERIALIZE_SCALAR(associativity);
+    SERIALIZE_CONTAINER(IPV_Graph);
+    SERIALIZE_CONTAINER(sets);
+    SERIALIZE_CONTAINER(missCounters);
+    SERIALIZE_SCALAR(winner);
+    SERIALIZE_CONTAINER(shct);
+    SERIALIZE_CONTAINER(partitionWays);
+    SERIALIZE_CONTAINER(utilityHits);
+    SERIALIZE_SCALAR(fillsSincePartition);
+}
+
+void
+LRUIPVRP::unserialize(CheckpointIn &cp)
+{
+    unsigned associativity;
+    UNSERIALIZE_SCALAR(associativity);
+    fatal_if(associativity != this->associativity,
+             "LRUIPVRP checkpoint is of a %d-way cache, not %d-way\n",
+             associativity, this->associativity);
+    std::vector<int> IPV_Graph;
+    UNSERIALIZE_CONTAINER(IPV_Graph);
+    fatal_if(IPV_Graph != this->IPV_Graph, "LRUIPVRP checkpoint was taken with other IPVs\n");
+
+    std::vector<uint64_t> sets;
+    UNSERIALIZE_CONTAINER(sets);
+    fatal_if(sets.size() % setWords || sets.size() < this->sets.size(),
+             "LRUIPVRP checkpoint holds %d words of set state, expected %d\n",
+             sets.size(), this->sets.size());
+    this->sets = sets;
+    for (size_t set = 0; set < this->sets.size() / setWords; set++) {
+        for (unsigned word = 0; word < LRUIPVKernel::validWords(associativity); word++) {
+            setState(set)[LRUIPVKernel::positionWords(associativity) + word] = 0; // The cache restores its blocks invalid
+        }
+    }
+
+    UNSERIALIZE_CONTAINER(missCounters);
+    UNSERIALIZE_SCALAR(winner);
+    fatal_if(missCounters.size() != numVectors || winner >= numVectors,
+             "LRUIPVRP checkpoint set dueling state is corrupt\n");
+
+    std::vector<uint8_t> shct;
+    UNSERIALIZE_CONTAINER(shct);
+    fatal_if(shct.size() != shctEntries,
+             "LRUIPVRP checkpoint holds %d signature history counters, expected %d\n",
+             shct.size(), shctEntries);
+    for (uint8_t counter : shct) {
+        fatal_if(counter > shctMax, "LRUIPVRP checkpoint signature history counters are corrupt\n");
+    }
+    this->shct = shct;
+
+    std::vector<unsigned> partitionWays;
+    std::vector<uint64_t> utilityHits;
+    UNSERIALIZE_CONTAINER(partitionWays);
+    UNSERIALIZE_CONTAINER(utilityHits);
+    UNSERIALIZE_SCALAR(fillsSincePartition);
+    fatal_if(partitionWays.size() != numOwners || utilityHits.size() != this->utilityHits.size() ||
+             std::accumulate(partitionWays.begin(), partitionWays.end(), 0u) > associativity,
+             "LRUIPVRP checkpoint was taken with other partition owners\n");
+    this->partitionWays = partitionWays;
+    this->utilityHits = utilityHits;
+    for (unsigned owner = 0; owner < numOwners; owner++) {
+        partitionStats.ownerWays[owner] = partitionWays[owner];
+    }
 }
 
 LRUIPVRP*
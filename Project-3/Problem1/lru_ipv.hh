@@ -1,32 +1,309 @@
 #ifndef __MEM_CACHE_REPLACEMENT_POLICIES_LRU_IPV_RP_HH__
 #define __MEM_CACHE_REPLACEMENT_POLICIES_LRU_IPV_RP_HH__
 
+#include <vector>
+
+#include "base/event_trace.hh"
+#include "base/statistics.hh"
+#include "base/types.hh"
 #include "mem/cache/replacement_policies/base.hh"
+#include "mem/cache/replacement_policies/lru_ipv_set.hh"
+#include "sim/serialize.hh"
 
 
 
 struct LRUIPVRPParams;
+class CacheBlk;
+class System;
 
 class LRUIPVRP : public BaseReplacementPolicy
 {
 
     protected:
     
-    int blockCount;   // Variable to keep track of total number of blocks initialized/created. # of blocks = associativity should be indexed by same object
+    int blockCount;   // Variable to keep track of total number of blocks initialized/created, the arena grows by one set every associativity blocks
     
-    const std::vector<int> IPV_Graph {0,0,1,0,3,0,1,2,1,0,5,1,0,0,1,11,13}; // Insertion and promotion vector to be followed
+    const unsigned associativity; // Set associativity, taken from the cache
+
+    const std::vector<int> IPV_Graph; // Insertion and promotion vectors, associativity+1 entries each: new position of a block hit at position i, followed by the insertion position
+
+    const unsigned numVectors; // Number of IPVs in IPV_Graph, more than one makes the sets duel
+
+    const unsigned leaderSetPeriod; // Every leaderSetPeriod sets start with one leader set per IPV
+
+    const unsigned missCounterMax; // Value the per IPV miss counters saturate at
+
+    const unsigned setWords; // Words of packed state per set, see lru_ipv_set.hh
+
+    /* Number of replacement data entries carved out of one arena chunk */
+    static const int entriesPerChunk = 4096;
 
-    const int associativity = 16; // Set associativity
+    /* Set index of replacement data whose set is not known yet */
+    static const uint32_t unbound = ~uint32_t(0);
 
-    std::vector<int> *ptr_LRUIPVCache;  // Pointer to vector which will contain current positions of each block initialized
+    mutable std::vector<uint64_t> sets;  // Packed recency state of every set, contiguous, setWords words per set
+
+    mutable std::vector<unsigned> missCounters; // Saturating count of the misses in the leader sets of each IPV
+
+    mutable unsigned winner; // IPV the follower sets use, the one whose leader sets miss least
 
     struct LRUIPVReplData : ReplacementData     // Structure to store information about individual blocks
     {
-        std::shared_ptr<std::vector<int>> position;  // Shared pointer among objects to keep track of 16 blocks
-        mutable int blockIndex;   // Index of a block to be used as an index to extract new position from IPV
-        LRUIPVReplData(int blockIndex,std::shared_ptr<std::vector<int>> position); // Default constructor for the structure
+        uint32_t set;   // Set of the block as given by the indexing policy, unbound until first seen as a candidate
+        uint32_t way;   // Way of the block as given by the indexing policy
+        bool prefetched; // Filled by a prefetcher and not hit since
+        const CacheBlk *blk; // Block the data belongs to, null outside caches
+        uint32_t signature; // Signature history counter the block was predicted with
+        bool predictedDead; // Its signature predicted no reuse at fill time
+        bool reused; // Hit since it was filled
+        bool shipSampled; // Filled in a training set, its outcome trains the counters
+        int16_t owner; // Partition owner that filled the block, -1 while invalid
+        LRUIPVReplData(uint32_t set = unbound, uint32_t way = 0); // Default constructor for the structure
+    };
+
+    /* Chunk of replacement data currently being handed out. Blocks share the
+     * chunk's reference count instead of owning a control block each. */
+    std::shared_ptr<std::vector<LRUIPVReplData>> chunk;
+
+    /**
+     * Returns the packed state of a set.
+     * @param set Index of the set.
+     */
+    uint64_t *setState(uint32_t set) const { return &sets[set * setWords]; }
+
+    /**
+     * Returns the IPV a set runs with: its own in a leader set, the
+     * current winner in a follower set. With a single IPV there are no
+     * leader sets and leaderSetPeriod may be 0.
+     * @param set Index of the set.
+     */
+    unsigned
+    vectorOf(uint32_t set) const
+    {
+        if (numVectors == 1) {
+            return 0;
+        }
+        unsigned offset = set % leaderSetPeriod;
+        return offset < numVectors ? offset : winner;
+    }
+
+    /**
+     * Returns the entries of one IPV.
+     * @param vector Index of the IPV.
+     */
+    const int *ipv(unsigned vector) const { return &IPV_Graph[vector * (associativity + 1)]; }
+
+    /**
+     * Counts a miss in a leader set and lets the follower sets switch to
+     * the IPV with the fewest misses. When a counter saturates all of them
+     * are halved, so older phases weigh less and the order is kept.
+     * @param vector IPV of the leader set.
+     */
+    void leaderMiss(unsigned vector) const;
+
+    struct DuelingStats : public Stats::Group
+    {
+        DuelingStats(Stats::Group *parent, unsigned vectors);
+
+        /** Misses in the leader sets of each IPV */
+        Stats::Vector leaderMisses;
+        /** Blocks inserted in follower sets with each IPV */
+        Stats::Vector followerInsertions;
+        /** Times the follower sets switched to another IPV */
+        Stats::Scalar switches;
+    };
+
+    mutable DuelingStats stats;
+
+    const unsigned reuseSamplePeriod; // The last set of every reuseSamplePeriod sets profiles reuse distances, 0 disables profiling
+
+    const unsigned reuseDistanceMax; // Deepest reuse distance told apart, deeper reuses and first accesses overflow
+
+    mutable std::vector<std::vector<Addr>> reuseStacks; // Tags of each sampled set, most recently accessed first
+
+    /**
+     * Records an access to a block of a sampled set in the reuse distance
+     * profile: the number of distinct blocks the set accessed since the
+     * last access to the same block.
+     * @param data Replacement data of the block, not sampled sets are ignored.
+     */
+    void sampleReuse(const LRUIPVReplData *data) const;
+
+    struct ProfileStats : public Stats::Group
+    {
+        ProfileStats(Stats::Group *parent, unsigned ways, unsigned reuseDistanceMax);
+
+        /** Hits at each recency position, 0 is the MRU end */
+        Stats::Vector hitPositions;
+        /** Blocks inserted at each recency position */
+        Stats::Vector insertPositions;
+        /** Valid victims evicted from each recency position */
+        Stats::Vector victimPositions;
+        /** Victims picked because their way was invalid */
+        Stats::Scalar invalidVictims;
+        /** Distinct blocks accessed in a sampled set between two accesses to the same block */
+        Stats::Distribution reuseDistance;
+    };
+
+    mutable ProfileStats profile;
+
+    System *system; // Names the requestors, to tell prefetchers apart
+
+    const std::string prefetcherName; // Requestors whose name contains it are prefetchers
+
+    const int prefetchInsertPosition; // Insertion position of prefetched blocks, -1 to insert them like demand fills
+
+    const int prefetchHitPosition; // Position a prefetched block moves to on its first hit, -1 to promote it with the IPV
+
+    /* What the policy knows about a requestor, looked up by name once */
+    struct RequestorInfo
+    {
+        bool known;         // Looked up already
+        bool prefetcher;    // Its name contains prefetcherName
+        int16_t owner;      // Partition owner whose name prefixes its name, numOwners if none
+    };
+
+    mutable std::vector<RequestorInfo> requestors; // Indexed by requestor ID
+
+    mutable std::vector<Addr> prefetchEvicted; // Per way, tag of the valid block the last prefetch fill into it evicted, MaxAddr if none
+
+    /* Victim getVictim() last picked, the fill that follows replaces it */
+    mutable uint32_t victimSet;
+    mutable uint32_t victimWay;
+    mutable Addr victimTag;
+    mutable bool victimValid;
+
+    /**
+     * @return What is known about a requestor, looked up by name the first
+     * time it fills a block.
+     */
+    const RequestorInfo &requestorInfo(RequestorID requestor) const;
+
+    struct PrefetchStats : public Stats::Group
+    {
+        PrefetchStats(Stats::Group *parent);
+
+        /** Blocks filled by a prefetcher */
+        Stats::Scalar prefetchFills;
+        /** Prefetched blocks hit before leaving the cache */
+        Stats::Scalar usefulPrefetches;
+        /** Prefetched blocks evicted or invalidated without a hit */
+        Stats::Scalar uselessPrefetches;
+        /** Valid blocks evicted to make room for a prefetched block */
+        Stats::Scalar prefetchEvictions;
+        /** Demand fills of a block a prefetch fill had evicted */
+        Stats::Scalar pollutionMisses;
+        /** Fraction of the prefetched blocks that were hit */
+        Stats::Formula prefetchAccuracy;
+    };
+
+    mutable PrefetchStats prefetchStats;
+
+    const unsigned shctEntries; // Signature history counters, a power of 2, 0 disables dead block prediction
+
+    const unsigned shctMax; // Value the counters saturate at, a fill whose counter is 0 is predicted dead
+
+    const unsigned regionBits; // log2 of the blocks in a memory region, signatures are per region and requestor
+
+    const unsigned shipSamplePeriod; // The first set of every shipSamplePeriod sets trains the counters
+
+    mutable std::vector<uint8_t> shct; // Signature history counter table, how often blocks of a signature were reused
+
+    /**
+     * Returns the signature history counter of a block: a hash of the
+     * memory region it is in and the requestor that filled it.
+     * @param data Replacement data of a block with a cache block bound.
+     */
+    uint32_t signatureOf(const LRUIPVReplData *data) const;
+
+    /**
+     * Ends the life of a block filled in a training set: its counter is
+     * decremented if it was never reused and the prediction is scored.
+     * @param data Replacement data of the block, others are ignored.
+     */
+    void shipRetire(LRUIPVReplData *data) const;
+
+    struct ShipStats : public Stats::Group
+    {
+        ShipStats(Stats::Group *parent);
+
+        /** Fills whose signature predicted no reuse */
+        Stats::Scalar predictedDead;
+        /** Fills predicted dead and inserted at the LRU end */
+        Stats::Scalar deadInsertions;
+        /** Training set blocks predicted dead and never reused */
+        Stats::Scalar correctDead;
+        /** Training set blocks predicted dead but reused */
+        Stats::Scalar wrongDead;
+        /** Training set blocks predicted live and reused */
+        Stats::Scalar correctLive;
+        /** Training set blocks predicted live but never reused */
+        Stats::Scalar wrongLive;
+        /** Fraction of the training set blocks predicted right */
+        Stats::Formula predictionAccuracy;
     };
 
+    mutable ShipStats shipStats;
+
+    const std::vector<std::string> owners; // Name prefixes of the partition owners, usually one per core
+
+    const unsigned numOwners; // Owners named, requestors matching none share one more owner that is not partitioned
+
+    const unsigned partitionPeriod; // Fills between way allocations, 0 only reports per owner stats
+
+    const unsigned umonSamplePeriod; // The first set of every umonSamplePeriod sets feeds the utility monitors
+
+    mutable unsigned fillsSincePartition; // Fills since the ways were last allocated
+
+    mutable std::vector<unsigned> partitionWays; // Ways allocated to each owner, its blocks are inserted that far from the LRU end
+
+    mutable std::vector<uint64_t> utilityHits; // Per owner and LRU stack position, hits it would have had alone in a sampled set
+
+    mutable std::vector<std::vector<Addr>> umonStacks; // Per sampled set and owner, tags of its blocks most recently accessed first
+
+    /**
+     * Records an access to a block of a sampled set in the utility monitor
+     * of its owner: the owner's own LRU stack position the block is found
+     * at, as if the owner had the whole set.
+     * @param data Replacement data of the block, not sampled sets are ignored.
+     */
+    void sampleUtility(const LRUIPVReplData *data) const;
+
+    /**
+     * Allocates the ways among the owners with the lookahead algorithm of
+     * utility-based cache partitioning: every owner gets a way, the others
+     * go one batch at a time to the owner with the most hits to gain per
+     * way. The utility counters are halved afterwards.
+     */
+    void partition() const;
+
+    struct PartitionStats : public Stats::Group
+    {
+        PartitionStats(Stats::Group *parent, const std::vector<std::string> &owners);
+
+        /** Hits per owner of the block */
+        Stats::Vector ownerHits;
+        /** Blocks filled per owner */
+        Stats::Vector ownerMisses;
+        /** Valid blocks per owner, averaged over time */
+        Stats::AverageVector ownerOccupancy;
+        /** Ways allocated per owner, averaged over time */
+        Stats::AverageVector ownerWays;
+        /** Times the ways were allocated anew */
+        Stats::Scalar repartitions;
+    };
+
+    mutable PartitionStats partitionStats;
+
+    mutable EventTrace::Writer eventTrace; // Binary trace of touches, resets, victims and invalidations, only open when requested
+
+    /**
+     * Records the set and way the indexing policy gave each candidate, so
+     * set membership does not depend on the order entries were instantiated.
+     * @param candidates All the ways of one set.
+     */
+    void bind(const ReplacementCandidates& candidates) const;
+
     public:
 
     typedef LRUIPVRPParams Params;
@@ -35,7 +312,7 @@ class LRUIPVRP : public BaseReplacementPolicy
 
     /**
      * Invalidate replacement data to set it as the next probable victim.
-     * Sets its last touch tick as the starting tick.
+     * Clears its valid bit and moves it to the LRU end of its set.
      *
      * @param replacement_data Replacement data to be invalidated.
      */
@@ -44,7 +321,9 @@ class LRUIPVRP : public BaseReplacementPolicy
 
     /**
      * Touch an entry to update its replacement data.
-     * Sets its last touch tick as the current tick.
+     * Promotes it to the position the IPV of its set gives for its
+     * current position, or on the first hit of a prefetched block to
+     * prefetchHitPosition if set.
      *
      * @param replacement_data Replacement data to be touched.
      */
@@ -53,7 +332,11 @@ class LRUIPVRP : public BaseReplacementPolicy
 
     /**
      * Reset replacement data. Used when an entry is inserted.
-     * Sets its last touch tick as the current tick.
+     * Places it at the insertion position of the IPV of its set, as far
+     * from the LRU end as its owner has ways when partitioning, a
+     * prefetched block at prefetchInsertPosition if set, or at the LRU end
+     * if its signature predicts no reuse and the set does not train. A
+     * demand miss in a leader set also counts against that leader's IPV.
      *
      * @param replacement_data Replacement data to be reset.
      */
@@ -61,7 +344,8 @@ class LRUIPVRP : public BaseReplacementPolicy
                                                                      override;
 
     /**
-     * Find replacement victim using LRU timestamps.
+     * Find replacement victim: an invalid way, or the block at the LRU
+     * end of the set.
      *
      * @param candidates Replacement candidates, selected by indexing policy.
      * @return Replacement entry to be replaced.
@@ -76,6 +360,19 @@ class LRUIPVRP : public BaseReplacementPolicy
      */
     std::shared_ptr<ReplacementData> instantiateEntry() override;
 
+    /**
+     * Checkpoints the recency positions of every set, the state of the
+     * set dueling, the signature history counters and the way allocation.
+     */
+    void serialize(CheckpointOut &cp) const override;
+
+    /**
+     * Restores the recency positions and set dueling state of a policy with
+     * the same associativity and IPVs. Caches do not checkpoint their
+     * blocks, so every way comes back invalid in its recency position.
+     */
+    void unserialize(CheckpointIn &cp) override;
+
 };
 
 
@@ -0,0 +1,306 @@
+#ifndef __MEM_CACHE_REPLACEMENT_POLICIES_LRU_IPV_SET_HH__
+#define __MEM_CACHE_REPLACEMENT_POLICIES_LRU_IPV_SET_HH__
+
+#include <cstdint>
+
+/**
+ * Packed recency state of LRU-IPV sets. Position 0 is the MRU end of a
+ * set's recency stack and position ways-1 the LRU end. The state of a set
+ * is a run of 64-bit words: the positions of its ways, followed by a valid
+ * mask with one bit per way.
+ *
+ * Sets of up to 16 ways keep one 4-bit position per way in a single word,
+ * wider sets keep one byte per way. Lanes past the last way hold the
+ * largest lane value, which no kernel ever matches or shifts. The kernels
+ * below update every lane of a word at once without branches.
+ */
+namespace LRUIPVKernel
+{
+
+const unsigned maxWays = 127;                           // Largest position a byte lane can hold
+const uint64_t nibbles = 0x0F0F0F0F0F0F0F0FULL;         // Low nibble of every byte
+const uint64_t ones = 0x0101010101010101ULL;            // 1 in every byte
+const uint64_t highs = 0x8080808080808080ULL;           // Top bit of every byte
+
+/**
+ * @return Number of words holding the positions of a set.
+ */
+inline unsigned
+positionWords(unsigned ways)
+{
+    return ways <= 16 ? 1 : (ways + 7) / 8;
+}
+
+/**
+ * @return Number of words holding the valid mask of a set.
+ */
+inline unsigned
+validWords(unsigned ways)
+{
+    return (ways + 63) / 64;
+}
+
+/**
+ * Compares every byte lane of a word holding values 0..127 with c.
+ * Setting the top bit of each lane before subtracting keeps borrows from
+ * crossing into the next lane.
+ * @return The top bit of each lane set where the lane is >= c.
+ */
+inline uint64_t
+atLeast(uint64_t lanes, unsigned c)
+{
+    return ((lanes | highs) - c * ones) & highs;
+}
+
+/**
+ * Shifts the byte lanes lying between two positions one step towards the
+ * position a way is leaving. Both directions are computed unconditionally,
+ * one of the two masks is always empty.
+ */
+inline uint64_t
+shiftLanes(uint64_t lanes, unsigned from, unsigned to)
+{
+    uint64_t up = atLeast(lanes, to) & ~atLeast(lanes, from);           // Promotion: [to, from) moves towards LRU
+    uint64_t down = atLeast(lanes, from + 1) & ~atLeast(lanes, to + 1); // Demotion: (from, to] moves towards MRU
+    return lanes + (up >> 7) - (down >> 7);
+}
+
+/**
+ * @return The top bit of each byte lane holding exactly pos.
+ */
+inline uint64_t
+matchLanes(uint64_t lanes, unsigned pos)
+{
+    return ~atLeast(lanes ^ (pos * ones), 1) & highs;
+}
+
+/**
+ * Puts a freshly instantiated set in order: way i sits at position i and
+ * no way is valid.
+ */
+inline void
+init(uint64_t *set, unsigned ways)
+{
+    unsigned words = positionWords(ways);
+    unsigned bits = ways <= 16 ? 4 : 8;
+    uint64_t filler = ways <= 16 ? 0xF : 0x7F;
+    for (unsigned word = 0; word < words; word++) {
+        set[word] = 0;
+        for (unsigned lane = 0; lane < 64 / bits; lane++) {
+            unsigned way = word * (64 / bits) + lane;
+            set[word] |= (way < ways ? way : filler) << (lane * bits);
+        }
+    }
+    for (unsigned word = 0; word < validWords(ways); word++) {
+        set[words + word] = 0;
+    }
+}
+
+/**
+ * @return The recency position of a way.
+ */
+inline unsigned
+position(const uint64_t *set, unsigned ways, unsigned way)
+{
+    if (ways <= 16) {
+        return (set[0] >> (4 * way)) & 0xF;
+    }
+    return (set[way / 8] >> (8 * (way % 8))) & 0xFF;
+}
+
+/**
+ * Moves a way to a new recency position, the ways in between shift by one
+ * towards the position the way left.
+ * @param set Packed state of the set.
+ * @param way The way to move.
+ * @param to The new position of the way.
+ */
+inline void
+move(uint64_t *set, unsigned ways, unsigned way, unsigned to)
+{
+    unsigned from = position(set, ways, way);
+    if (ways <= 16) {
+        uint64_t even = shiftLanes(set[0] & nibbles, from, to);        // Ways 0, 2, 4, ... one per byte
+        uint64_t odd = shiftLanes((set[0] >> 4) & nibbles, from, to);  // Ways 1, 3, 5, ... one per byte
+        set[0] = (even | (odd << 4)) & ~(uint64_t(0xF) << (4 * way));
+        set[0] |= uint64_t(to) << (4 * way);
+        return;
+    }
+    for (unsigned word = 0; word < positionWords(ways); word++) {
+        set[word] = shiftLanes(set[word], from, to);
+    }
+    set[way / 8] &= ~(uint64_t(0xFF) << (8 * (way % 8)));
+    set[way / 8] |= uint64_t(to) << (8 * (way % 8));
+}
+
+/**
+ * Finds the way sitting at a recency position.
+ * @param set Packed state of the set.
+ * @param pos The position looked for.
+ * @return The way at that position.
+ */
+inline unsigned
+wayAt(const uint64_t *set, unsigned ways, unsigned pos)
+{
+    if (ways <= 16) {
+        uint64_t match = (matchLanes(set[0] & nibbles, pos) >> 7) |        // Way 2k reported at bit 8k
+                         (matchLanes((set[0] >> 4) & nibbles, pos) >> 3);  // Way 2k+1 reported at bit 8k+4
+        return __builtin_ctzll(match) >> 2;
+    }
+    unsigned word = 0;
+    uint64_t match = matchLanes(set[0], pos);
+    while (!match) {
+        match = matchLanes(set[++word], pos);
+    }
+    return word * 8 + (__builtin_ctzll(match) >> 3);
+}
+
+/**
+ * @return Whether a way holds a valid block.
+ */
+inline bool
+isValid(const uint64_t *set, unsigned ways, unsigned way)
+{
+    return (set[positionWords(ways) + way / 64] >> (way % 64)) & 1;
+}
+
+/**
+ * Sets or clears the valid bit of a way.
+ */
+inline void
+setValid(uint64_t *set, unsigned ways, unsigned way, bool valid)
+{
+    uint64_t &word = set[positionWords(ways) + way / 64];
+    word = (word & ~(uint64_t(1) << (way % 64))) | (uint64_t(valid) << (way % 64));
+}
+
+/**
+ * Picks the victim of a set: an invalid way if there is one, the way at the
+ * LRU end of the stack otherwise.
+ * @return The victim way.
+ */
+inline unsigned
+victim(const uint64_t *set, unsigned ways)
+{
+    const uint64_t *valid = set + positionWords(ways);
+    for (unsigned word = 0; word < validWords(ways); word++) {
+        unsigned last = ways - word * 64;
+        uint64_t present = last >= 64 ? ~uint64_t(0) : (uint64_t(1) << last) - 1;
+        uint64_t invalid = ~valid[word] & present;
+        if (invalid) {
+            return word * 64 + __builtin_ctzll(invalid);
+        }
+    }
+    return wayAt(set, ways, ways - 1);
+}
+
+/**
+ * Kernels specialized for a way count known at compile time. The layout
+ * checks and word loops above fold away, leaving straight-line code.
+ */
+template <unsigned Ways>
+struct Fixed
+{
+    static_assert(Ways > 0 && Ways <= maxWays, "Unsupported associativity");
+
+    unsigned ways() const { return Ways; }
+    unsigned words() const { return positionWords(Ways) + validWords(Ways); }
+    void init(uint64_t *set) const { LRUIPVKernel::init(set, Ways); }
+    unsigned position(const uint64_t *set, unsigned way) const
+    { return LRUIPVKernel::position(set, Ways, way); }
+    void move(uint64_t *set, unsigned way, unsigned to) const
+    { LRUIPVKernel::move(set, Ways, way, to); }
+    unsigned wayAt(const uint64_t *set, unsigned pos) const
+    { return LRUIPVKernel::wayAt(set, Ways, pos); }
+    bool isValid(const uint64_t *set, unsigned way) const
+    { return LRUIPVKernel::isValid(set, Ways, way); }
+    void setValid(uint64_t *set, unsigned way, bool valid) const
+    { LRUIPVKernel::setValid(set, Ways, way, valid); }
+    unsigned victim(const uint64_t *set) const
+    { return LRUIPVKernel::victim(set, Ways); }
+};
+
+/**
+ * Kernels for a way count only known at run time, used for the uncommon
+ * associativities that have no specialization.
+ */
+struct Dynamic
+{
+    unsigned numWays;
+
+    Dynamic(unsigned ways) : numWays(ways) {}
+
+    unsigned ways() const { return numWays; }
+    unsigned words() const { return positionWords(numWays) + validWords(numWays); }
+    void init(uint64_t *set) const { LRUIPVKernel::init(set, numWays); }
+    unsigned position(const uint64_t *set, unsigned way) const
+    { return LRUIPVKernel::position(set, numWays, way); }
+    void move(uint64_t *set, unsigned way, unsigned to) const
+    { LRUIPVKernel::move(set, numWays, way, to); }
+    unsigned wayAt(const uint64_t *set, unsigned pos) const
+    { return LRUIPVKernel::wayAt(set, numWays, pos); }
+    bool isValid(const uint64_t *set, unsigned way) const
+    { return LRUIPVKernel::isValid(set, numWays, way); }
+    void setValid(uint64_t *set, unsigned way, bool valid) const
+    { LRUIPVKernel::setValid(set, numWays, way, valid); }
+    unsigned victim(const uint64_t *set) const
+    { return LRUIPVKernel::victim(set, numWays); }
+};
+
+/**
+ * Promotes a block hit at its current position to the position the IPV
+ * gives for it.
+ * @param ipv Insertion and promotion vector of ways+1 entries.
+ */
+template <class Kernel>
+inline void
+hit(const Kernel &kernel, uint64_t *set, unsigned way, const int *ipv)
+{
+    kernel.move(set, way, ipv[kernel.position(set, way)]);
+}
+
+/**
+ * Marks a newly filled way valid and places it at an insertion position.
+ */
+template <class Kernel>
+inline void
+insert(const Kernel &kernel, uint64_t *set, unsigned way, unsigned position)
+{
+    kernel.setValid(set, way, true);
+    kernel.move(set, way, position);
+}
+
+/**
+ * Marks a way invalid and parks it at the LRU end of the set, victim()
+ * picks it before any valid way.
+ */
+template <class Kernel>
+inline void
+invalidate(const Kernel &kernel, uint64_t *set, unsigned way)
+{
+    kernel.setValid(set, way, false);
+    kernel.move(set, way, kernel.ways() - 1);
+}
+
+/**
+ * Calls op with the kernels of the given associativity: a specialization for
+ * the common way counts, the run-time kernels otherwise. The switch is on a
+ * value fixed for the lifetime of a cache, so it always predicts.
+ */
+template <class Op>
+inline auto
+dispatch(unsigned ways, Op &&op) -> decltype(op(Dynamic(ways)))
+{
+    switch (ways) {
+      case 2: return op(Fixed<2>());
+      case 4: return op(Fixed<4>());
+      case 8: return op(Fixed<8>());
+      case 16: return op(Fixed<16>());
+      case 32: return op(Fixed<32>());
+      default: return op(Dynamic(ways));
+    }
+}
+
+} // namespace LRUIPVKernel
+
+#endif // __MEM_CACHE_REPLACEMENT_POLICIES_LRU_IPV_SET_HH__
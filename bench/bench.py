@@ -0,0 +1,296 @@
+#!/usr/bin/env python3
+"""Benchmark and regression harness for the GSelect and LRU-IPV projects.
+
+The benchmark x configuration matrix is the set of runs recorded under
+Project-2/Problem2 and Project-3/Problem2: every <benchmark>-<Conf> directory
+holds the config.ini and stats.txt of one run. Each run is reproduced by
+translating its config.ini back into a se.py command line, and its stats.txt
+is the stored baseline the new result is compared against.
+
+    bench.py list
+        Show the matrix and the se.py arguments of every run.
+    bench.py run --gem5-root DIR [--gem5 BINARY] [-j JOBS] [--only TEXT]
+                 [--bp-type NAME] [--outdir DIR]
+        Run the matrix as concurrent local gem5 jobs, from the gem5 root so
+        the benchmark paths recorded in config.ini resolve. Results go to
+        bench/runs/<project>/<run>. --bp-type swaps GSelect for another
+        branch predictor with its default parameters, e.g. PerceptronBP.
+        Only the runs recorded with GSelectBP are run then, so comparing
+        them with the baselines reports its accuracy and host_inst_rate
+        against GSelect and never against the Tournament runs.
+    bench.py report [STATS_DIR...]
+        Tabulate stats.txt files: the baselines, or the given directories.
+    bench.py compare [--runs DIR] [--gselect-only] [--sim-tolerance F]
+                     [--host-tolerance F]
+        Compare the latest runs with the baselines and flag every metric
+        that got worse by more than its tolerance. Exits with 1 if any did.
+        --gselect-only skips the baselines not recorded with GSelectBP.
+
+Simulated metrics are deterministic, so any change beyond the simulated
+tolerance (1% by default) is real. Host metrics depend on the machine and
+its load, and get a wider tolerance (10% by default). Compare host
+throughput against baselines recorded on the same host.
+"""
+
+import argparse
+import concurrent.futures
+import configparser
+import os
+import subprocess
+import sys
+import time
+
+REPO = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BASELINES = ['Project-2/Problem2', 'Project-3/Problem2']
+RUNS = os.path.join(REPO, 'bench', 'runs')
+
+# Metric name, stats.txt entry or function of the parsed stats, whether
+# higher is better, whether it measures the host rather than the simulation
+METRICS = [
+    ('sim_insts', 'sim_insts', True, False),
+    ('ipc', 'system.cpu.ipc', True, False),
+    ('bp_accuracy',
+     lambda s: 1.0 - s['system.cpu.branchPred.condIncorrect'] /
+                     s['system.cpu.branchPred.condPredicted'],
+     True, False),
+    ('l1d_miss_rate', 'system.cpu.dcache.overall_miss_rate::total', False, False),
+    ('l1i_miss_rate', 'system.cpu.icache.overall_miss_rate::total', False, False),
+    ('l2_miss_rate', 'system.l2.overall_miss_rate::total', False, False),
+    ('host_inst_rate', 'host_inst_rate', True, True),
+    ('host_seconds', 'host_seconds', False, True),
+]
+
+# GSelectBP parameters that are not se.py options
+GSELECT_PARAMS = ['CounterPredictorSize', 'CounterCtrBits', 'globalHistoryBits']
+
+
+def parse_stats(path):
+    """Returns the last statistics dump of a stats.txt as a dict."""
+    dumps = []
+    with open(path) as f:
+        for line in f:
+            if line.startswith('---------- Begin'):
+                dumps.append({})
+                continue
+            fields = line.split()
+            if len(fields) < 2 or line.startswith('-') or not dumps:
+                continue
+            try:
+                dumps[-1][fields[0]] = float(fields[1])
+            except ValueError:
+                pass
+    return dumps[-1] if dumps else {}
+
+
+def metrics(stats):
+    """Returns the harness metrics of parsed stats, None where missing."""
+    values = {}
+    for name, source, _, _ in METRICS:
+        try:
+            values[name] = source(stats) if callable(source) else stats[source]
+        except (KeyError, ZeroDivisionError):
+            values[name] = None
+    return values
+
+
+def recorded_bp(baseline):
+    """Returns the branch predictor type a baseline run was recorded with."""
+    config = configparser.ConfigParser(strict=False, interpolation=None)
+    config.read(os.path.join(baseline, 'config.ini'))
+    return config.get('system.cpu.branchPred', 'type', fallback=None)
+
+
+def se_args(config_ini, bp_type=None):
+    """Translates a recorded config.ini back into se.py arguments, with
+    another branch predictor if bp_type is given."""
+    config = configparser.ConfigParser(strict=False, interpolation=None)
+    config.read(config_ini)
+
+    def get(section, key):
+        return config.get(section, key, fallback=None)
+
+    args = ['--cpu-type=' + get('system.cpu', 'type'), '--caches']
+    for option, section in (('l1d', 'system.cpu.dcache'),
+                            ('l1i', 'system.cpu.icache'),
+                            ('l2', 'system.l2')):
+        if get(section, 'size'):
+            if option == 'l2':
+                args.append('--l2cache')
+            args += ['--%s_size=%sB' % (option, get(section, 'size')),
+                     '--%s_assoc=%s' % (option, get(section, 'assoc'))]
+    start, end = get('system', 'mem_ranges').split(':')
+    args.append('--mem-size=%dB' % (int(end) - int(start)))
+
+    bp = bp_type or get('system.cpu.branchPred', 'type')
+    args.append('--bp-type=' + bp)
+    if bp == 'GSelectBP':
+        for param in GSELECT_PARAMS:
+            args += ['--param', 'system.cpu[:].branchPred.%s=%s' %
+                     (param, get('system.cpu.branchPred', param))]
+
+    rp = get('system.l2.replacement_policy', 'type')
+    if rp and rp != 'LRURP':
+        args += ['--param', 'system.l2.replacement_policy=%s()' % rp]
+        ipv = get('system.l2.replacement_policy', 'ipv')
+        if ipv:
+            args += ['--param', 'system.l2.replacement_policy.ipv=[%s]' %
+                     ', '.join(ipv.split())]
+
+    command = get('system.cpu.workload', 'cmd').split()
+    args += ['-c', command[0]]
+    if len(command) > 1:
+        args += ['-o', ' '.join(command[1:])]
+    return args
+
+
+def matrix():
+    """Returns (run name, baseline directory) for every recorded run."""
+    runs = []
+    for base in BASELINES:
+        root = os.path.join(REPO, base)
+        for name in sorted(os.listdir(root)):
+            if os.path.exists(os.path.join(root, name, 'config.ini')):
+                project = base.split('/')[0]
+                runs.append(('%s/%s' % (project, name), os.path.join(root, name)))
+    return runs
+
+
+def run_one(gem5, gem5_root, runs, name, baseline, bp_type, extra):
+    outdir = os.path.join(runs, name)
+    os.makedirs(outdir, exist_ok=True)
+    command = [gem5, '--outdir=' + outdir,
+               os.path.join(gem5_root, 'configs', 'example', 'se.py')]
+    command += se_args(os.path.join(baseline, 'config.ini'), bp_type) + extra
+    start = time.time()
+    with open(os.path.join(outdir, 'simout.txt'), 'w') as log:
+        status = subprocess.call(command, cwd=gem5_root, stdout=log,
+                                 stderr=subprocess.STDOUT)
+    return name, status, time.time() - start
+
+
+def cmd_list(args):
+    for name, baseline in matrix():
+        print('%s\n    %s' % (name, ' '.join(
+            se_args(os.path.join(baseline, 'config.ini')))))
+
+
+def cmd_run(args):
+    gem5 = args.gem5 or os.path.join(args.gem5_root, 'build', 'X86', 'gem5.opt')
+    runs = [r for r in matrix() if not args.only or args.only in r[0]]
+    if args.bp_type:
+        # The other baselines use another predictor, which the swapped one
+        # must not be compared against
+        skipped = [r for r in runs if recorded_bp(r[1]) != 'GSelectBP']
+        runs = [r for r in runs if r not in skipped]
+        if skipped:
+            print('--bp-type: skipping %d runs not recorded with GSelectBP' %
+                  len(skipped))
+    with concurrent.futures.ThreadPoolExecutor(args.jobs) as pool:
+        futures = [pool.submit(run_one, os.path.abspath(gem5),
+                               os.path.abspath(args.gem5_root),
+                               os.path.abspath(args.outdir), name, baseline,
+                               args.bp_type, args.extra)
+                   for name, baseline in runs]
+        failed = 0
+        for future in concurrent.futures.as_completed(futures):
+            name, status, seconds = future.result()
+            failed += status != 0
+            print('%-40s %s in %.0fs' % (name, 'ok' if status == 0 else
+                                         'FAILED (%d)' % status, seconds))
+    return 1 if failed else 0
+
+
+def print_table(rows):
+    header = ['run'] + [m[0] for m in METRICS]
+    table = [header] + [[name] + ['-' if values[m[0]] is None else
+                                  '%.6g' % values[m[0]] for m in METRICS]
+                        for name, values in rows]
+    widths = [max(len(row[i]) for row in table) for i in range(len(header))]
+    for row in table:
+        print('  '.join(cell.ljust(widths[i]) if i == 0 else
+                        cell.rjust(widths[i]) for i, cell in enumerate(row)))
+
+
+def cmd_report(args):
+    if args.dirs:
+        dirs = [(d, d) for d in args.dirs]
+    else:
+        dirs = matrix()
+    rows = []
+    for name, path in dirs:
+        stats = os.path.join(path, 'stats.txt')
+        if os.path.exists(stats):
+            rows.append((name, metrics(parse_stats(stats))))
+    print_table(rows)
+
+
+def cmd_compare(args):
+    regressions = 0
+    compared = 0
+    for name, baseline in matrix():
+        current = os.path.join(args.runs, name, 'stats.txt')
+        if not os.path.exists(current):
+            continue
+        if args.gselect_only and recorded_bp(baseline) != 'GSelectBP':
+            continue
+        compared += 1
+        old = metrics(parse_stats(os.path.join(baseline, 'stats.txt')))
+        new = metrics(parse_stats(current))
+        for metric, _, higher_is_better, host in METRICS:
+            if old[metric] is None or new[metric] is None:
+                continue
+            tolerance = args.host_tolerance if host else args.sim_tolerance
+            change = ((new[metric] - old[metric]) / abs(old[metric])
+                      if old[metric] else new[metric] - old[metric])
+            worse = -change if higher_is_better else change
+            verdict = ('REGRESSION' if worse > tolerance else
+                       'improved' if -worse > tolerance else 'same')
+            regressions += verdict == 'REGRESSION'
+            if verdict != 'same' or args.verbose:
+                print('%-40s %-15s %12.6g -> %12.6g %+8.2f%%  %s' %
+                      (name, metric, old[metric], new[metric], 100 * change,
+                       verdict))
+    print('%d runs compared, %d regressions' % (compared, regressions))
+    return 1 if regressions else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest='command')
+    commands.required = True
+
+    commands.add_parser('list').set_defaults(func=cmd_list)
+
+    run = commands.add_parser('run')
+    run.add_argument('--gem5-root', required=True,
+                     help='gem5 tree holding configs/ and benchmarks/')
+    run.add_argument('--gem5', help='gem5 binary, build/X86/gem5.opt by default')
+    run.add_argument('-j', '--jobs', type=int, default=os.cpu_count())
+    run.add_argument('--only', help='only runs whose name contains this')
+    run.add_argument('--bp-type',
+                     help='branch predictor replacing GSelect, GSelect runs only')
+    run.add_argument('--outdir', default=RUNS, help='directory the runs go to')
+    run.add_argument('extra', nargs='*', help='extra se.py arguments, after --')
+    run.set_defaults(func=cmd_run)
+
+    report = commands.add_parser('report')
+    report.add_argument('dirs', nargs='*', help='directories holding stats.txt')
+    report.set_defaults(func=cmd_report)
+
+    compare = commands.add_parser('compare')
+    compare.add_argument('--runs', default=RUNS)
+    compare.add_argument('--gselect-only', action='store_true',
+                         help='only compare against the GSelectBP baselines')
+    compare.add_argument('--sim-tolerance', type=float, default=0.01)
+    compare.add_argument('--host-tolerance', type=float, default=0.10)
+    compare.add_argument('-v', '--verbose', action='store_true',
+                         help='also list the metrics that did not change')
+    compare.set_defaults(func=cmd_compare)
+
+    args = parser.parse_args()
+    sys.exit(args.func(args) or 0)
+
+
+if __name__ == '__main__':
+    main()